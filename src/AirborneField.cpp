@@ -0,0 +1,116 @@
+#include "AirborneField.h"
+#include <math.h>
+
+using namespace std;
+
+AirborneField::AirborneField()
+{
+	resolution = 1;
+	periodic = false;
+	origin = -1.0;
+	cellSize = 2.0;
+	inverseCellSize = 0.5;
+	peak = 0;
+}
+
+void AirborneField::create(double boxSize, int resolution, bool periodic, ThreadPool& pool)
+{
+	this->resolution = resolution < 1 ? 1 : resolution;
+	this->periodic = periodic;
+	origin = -boxSize;
+	cellSize = 2.0 * boxSize / this->resolution;
+	inverseCellSize = 1.0 / cellSize;
+
+	size_t cells = (size_t)this->resolution * this->resolution;
+	concentration.assign(cells, 0.0f);
+	updated.assign(cells, 0.0f);
+	infectionThreshold.assign(cells, 0);
+	emitters.reset(new atomic<unsigned int>[cells]);
+	for (size_t cell = 0;cell < cells;cell++) {
+		emitters[cell].store(0, memory_order_relaxed);
+	}
+	threadPeaks.assign(pool.size(), 0.0f);
+	peak = 0;
+}
+
+//One update of the stencil: every cell keeps keep of its own air and gets share of each of its four neighbors'
+void AirborneField::spread(float keep, float share, ThreadPool& pool)
+{
+	int n = resolution;
+	int last = n - 1;
+	pool.parallelFor(n, pool.grainFor(n, 16), [&](size_t begin, size_t end, int thread) {
+		for (size_t row = begin;row < end;row++) {
+			//A neighbor past a closed side is the cell itself, so nothing flows through it
+			size_t rowBelow = row > 0 ? row - 1 : periodic ? last : 0;
+			size_t rowAbove = row < (size_t)last ? row + 1 : periodic ? 0 : last;
+			const float* in = &concentration[row * n];
+			const float* below = &concentration[rowBelow * n];
+			const float* above = &concentration[rowAbove * n];
+			float* out = &updated[row * n];
+
+			//The first and the last column are the only ones whose neighbors aren't next to them in the row
+			int edges[2] = { 0, last };
+			for (int e = 0;e < (n > 1 ? 2 : 1);e++) {
+				int column = edges[e];
+				int left = column > 0 ? column - 1 : periodic ? last : 0;
+				int right = column < last ? column + 1 : periodic ? 0 : last;
+				float value = keep * in[column] + share * (in[left] + in[right] + below[column] + above[column]);
+				out[column] = value < AIRBORNE_FLOOR ? 0.0f : value;
+			}
+
+			//Without any branches or stores besides out, the compiler can vectorize the rest of the row
+			for (int column = 1;column < last;column++) {
+				float value = keep * in[column] + share * (in[column - 1] + in[column + 1] + below[column] + above[column]);
+				out[column] = value < AIRBORNE_FLOOR ? 0.0f : value;
+			}
+		}
+	});
+	concentration.swap(updated);
+}
+
+void AirborneField::update(double emission, double diffusion, double decay, double intake, double seconds, ThreadPool& pool)
+{
+	size_t cells = concentration.size();
+
+	//What every infectious agent breathes out over the step is spread over its whole cell
+	float emitted = (float)(emission * seconds * inverseCellSize * inverseCellSize);
+	pool.parallelFor(cells, pool.grainFor(cells, 4096), [&](size_t begin, size_t end, int thread) {
+		for (size_t cell = begin;cell < end;cell++) {
+			unsigned int count = emitters[cell].load(memory_order_relaxed);
+			if (count > 0) {
+				concentration[cell] += count * emitted;
+				emitters[cell].store(0, memory_order_relaxed);
+			}
+		}
+	});
+
+	//The air mixes with the neighboring cells in as many updates as it takes to keep every one of them stable, and the decay is split the same way
+	double spreadPerStep = diffusion * seconds * inverseCellSize * inverseCellSize;
+	int updates = (int)ceil(spreadPerStep / AIRBORNE_MAX_SPREAD);
+	updates = updates < 1 ? 1 : updates;
+	double share = spreadPerStep / updates;
+	double remaining = exp(-decay * seconds / updates);
+	for (int i = 0;i < updates;i++) {
+		spread((float)(remaining * (1 - 4 * share)), (float)(remaining * share), pool);
+	}
+
+	//Breathing in dose quanta infects with a chance of 1 - exp(-dose) (the Wells-Riley model), so the chance of a step only depends on the cell
+	double breathed = intake * seconds;
+	for (size_t t = 0;t < threadPeaks.size();t++) {
+		threadPeaks[t] = 0;
+	}
+	pool.parallelFor(cells, pool.grainFor(cells, 4096), [&](size_t begin, size_t end, int thread) {
+		float threadPeak = threadPeaks[thread];
+		for (size_t cell = begin;cell < end;cell++) {
+			float value = concentration[cell];
+			threadPeak = value > threadPeak ? value : threadPeak;
+			infectionThreshold[cell] = value > 0 ? (unsigned long long)ceil(-expm1(-value * breathed) * 9007199254740992.0) : 0;
+		}
+		threadPeaks[thread] = threadPeak;
+	});
+
+	peak = 0;
+	for (size_t t = 0;t < threadPeaks.size();t++) {
+		peak = threadPeaks[t] > peak ? threadPeaks[t] : peak;
+	}
+}
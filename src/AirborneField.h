@@ -0,0 +1,92 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "ThreadPool.h"
+
+//The most a cell can spread to each of its four neighbors in one update of the stencil. The update is only stable up to 0.25, so a step that would spread more is split into several updates.
+#define AIRBORNE_MAX_SPREAD 0.2
+
+//Concentrations below this are cleared, so a field that has decayed away doesn't end up full of denormals, which are many times slower to compute with
+#define AIRBORNE_FLOOR 1e-20f
+
+//The concentration of airborne particles over the simulation box, on a regular grid of cells, in quanta (infectious doses) per unit of area.
+//Every step the infectious agents breathe into the cell they are in, then the air of every cell mixes with its four neighbors (diffusion) and is cleared out (decay), and then every agent breathes in from its own cell. Each of these costs the same however close the agents are to each other, so the infection can reach across the whole box without checking any pairs.
+//The emitters are counted per cell rather than added up as concentrations, so the field is the same however many threads and in whatever order the agents get to it.
+//The sides of the box hold the air in, or pass it on to the opposite side in a periodic box. Walls and obstacles inside the box don't stop it.
+class AirborneField
+{
+	int resolution;
+	bool periodic;
+	double origin;
+	double cellSize;
+	double inverseCellSize;
+
+	//Every cell, row by row from the bottom of the box, and room for the next update of the stencil
+	std::vector<float> concentration;
+	std::vector<float> updated;
+
+	//The infectious agents in each cell in this step, counted from several threads at once
+	std::unique_ptr<std::atomic<unsigned int>[]> emitters;
+
+	//The chance of breathing in an infection in one step in each cell, as the threshold the top 53 bits of a random number have to stay under, like Simulation::transmissionThreshold
+	std::vector<unsigned long long> infectionThreshold;
+
+	//The highest concentration of the last step, from every thread's share of the cells
+	std::vector<float> threadPeaks;
+	float peak;
+
+	void spread(float keep, float share, ThreadPool& pool);
+
+public:
+	AirborneField();
+
+	//Makes a resolution x resolution grid over the box [-boxSize, boxSize]^2 with clean air in it
+	void create(double boxSize, int resolution, bool periodic, ThreadPool& pool);
+
+	int cellOf(double x, double y) const
+	{
+		int column = (int)((x - origin) * inverseCellSize);
+		int row = (int)((y - origin) * inverseCellSize);
+		column = column < 0 ? 0 : column >= resolution ? resolution - 1 : column;
+		row = row < 0 ? 0 : row >= resolution ? resolution - 1 : row;
+		return row * resolution + column;
+	}
+
+	//Counts an infectious agent at (x, y) towards what its cell gets in the next update. Can be called from several threads at once.
+	void emit(double x, double y)
+	{
+		emitters[cellOf(x, y)].fetch_add(1, std::memory_order_relaxed);
+	}
+
+	//Advances the air by seconds: adds emission quanta per second for every agent emit() counted, spreads it with a diffusion coefficient of diffusion (in units of area per second) and takes decay of it away per second.
+	//Then works out the chance of catching it in every cell for an agent that breathes in intake units of area of air per second.
+	void update(double emission, double diffusion, double decay, double intake, double seconds, ThreadPool& pool);
+
+	//The infection threshold of the cell at (x, y). 0 means there is nothing to catch.
+	unsigned long long threshold(double x, double y) const
+	{
+		return infectionThreshold[cellOf(x, y)];
+	}
+
+	//Whether there is anything left in the air after the last update
+	bool clean() const
+	{
+		return peak == 0;
+	}
+
+	float getPeak() const
+	{
+		return peak;
+	}
+
+	int getResolution() const
+	{
+		return resolution;
+	}
+
+	const std::vector<float>& getConcentration() const
+	{
+		return concentration;
+	}
+};
@@ -0,0 +1,199 @@
+//Runs every broad phase on the same populations placed in different ways, and reports which one is fastest for which placement.
+//The grid suits agents spread evenly over the box, the sweep suits agents strung out along a corridor, and the neighbor lists suit slow agents. This measures it instead of guessing.
+//Every run is written as one row of a CSV file, ready to be plotted.
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "Simulation.h"
+#include "Profiler.h"
+
+using namespace std;
+
+struct BroadPhaseRun
+{
+	Placement placement;
+	BroadPhase broadPhase;
+	double seconds;
+	double rate;
+	double broadPhaseSeconds;
+	double collisionSeconds;
+};
+
+static const char* placementName(Placement placement)
+{
+	switch (placement) {
+	case PLACEMENT_UNIFORM:
+		return "uniform";
+	case PLACEMENT_CORRIDOR:
+		return "corridor";
+	case PLACEMENT_CLUSTERED:
+		return "clustered";
+	default:
+		return "unknown";
+	}
+}
+
+static const char* broadPhaseName(BroadPhase broadPhase)
+{
+	switch (broadPhase) {
+	case BROADPHASE_GRID:
+		return "grid";
+	case BROADPHASE_PAIRWISE:
+		return "pairwise";
+	case BROADPHASE_VERLET:
+		return "verlet";
+	case BROADPHASE_SWEEP:
+		return "sweep";
+	case BROADPHASE_HIERARCHICAL:
+		return "hierarchical";
+	default:
+		return "unknown";
+	}
+}
+
+static void printUsage(const char* program)
+{
+	printf("usage: %s [options]\n", program);
+	printf("  --agents N          population of every run (default 100000)\n");
+	printf("  --density D         fraction of the box covered by circles of radius %g (default 0.02)\n", CIRCLE_RADIUS);
+	printf("  --radius-ratio R    how many times bigger than that the biggest circles are (default 1)\n");
+	printf("  --threads N         threads to step with, 0 for all hardware threads (default 0)\n");
+	printf("  --steps N           measured steps per run (default 20)\n");
+	printf("  --warmup N          unmeasured steps before measuring (default 2)\n");
+	printf("  --pairwise-limit N  largest population to also run the pairwise loop for (default 20000)\n");
+	printf("  --seed N            random seed (default 1)\n");
+	printf("  --csv FILE          where to write the results (default broadphase.csv)\n");
+}
+
+int main(int argc, char** argv)
+{
+	long long agents = 100000;
+	double density = 0.02;
+	double radiusRatio = 1;
+	int threads = 0;
+	int steps = 20;
+	int warmup = 2;
+	long long pairwiseLimit = 20000;
+	unsigned long long seed = 1;
+	const char* csvFile = "broadphase.csv";
+
+	for (int i = 1;i < argc;i++) {
+		if (strcmp(argv[i], "--agents") == 0 && i + 1 < argc) {
+			agents = atoll(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--density") == 0 && i + 1 < argc) {
+			density = atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--radius-ratio") == 0 && i + 1 < argc) {
+			radiusRatio = atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+			threads = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--steps") == 0 && i + 1 < argc) {
+			steps = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) {
+			warmup = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--pairwise-limit") == 0 && i + 1 < argc) {
+			pairwiseLimit = atoll(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+			seed = strtoull(argv[++i], NULL, 10);
+		}
+		else if (strcmp(argv[i], "--csv") == 0 && i + 1 < argc) {
+			csvFile = argv[++i];
+		}
+		else {
+			printUsage(argv[0]);
+			return strcmp(argv[i], "--help") == 0 ? 0 : 1;
+		}
+	}
+
+	//The agent indices are stored as 32 bit integers
+	if (agents < 1 || agents > 2000000000LL || density <= 0 || !(radiusRatio >= 1) || threads < 0 || steps < 1 || warmup < 0) {
+		printUsage(argv[0]);
+		return 1;
+	}
+
+	FILE* csv = fopen(csvFile, "w");
+	if (csv == NULL) {
+		fprintf(stderr, "Failed to open %s\n", csvFile);
+		return 1;
+	}
+	fprintf(csv, "placement,broad_phase,agents,threads,density,radius_ratio,box_size,steps,seconds,agent_steps_per_second,broad_phase_seconds,collision_seconds\n");
+
+	//density is the fraction of the whole box covered, so the corridor and the clusters are far more crowded than that.
+	//With a radius ratio k the mean squared radius is CIRCLE_RADIUS^2 * 2 ln(k) / (1 - 1 / k^2).
+	double meanSquaredRadius = CIRCLE_RADIUS * CIRCLE_RADIUS;
+	if (radiusRatio > 1) {
+		meanSquaredRadius *= 2 * log(radiusRatio) / (1 - 1 / (radiusRatio * radiusRatio));
+	}
+	double boxSize = sqrt(agents * PI * meanSquaredRadius / density) / 2.0;
+	Placement placements[] = { PLACEMENT_UNIFORM, PLACEMENT_CORRIDOR, PLACEMENT_CLUSTERED };
+	BroadPhase broadPhases[] = { BROADPHASE_GRID, BROADPHASE_VERLET, BROADPHASE_SWEEP, BROADPHASE_HIERARCHICAL, BROADPHASE_PAIRWISE };
+
+	printf("%lld agents, density %g, radius ratio %g, box %.3f, %d steps\n\n", agents, density, radiusRatio, boxSize, steps);
+	printf("%-10s %-12s %10s %16s %18s %18s\n", "placement", "broad", "seconds", "agent-steps/s", "broad-phase ns/as", "collision ns/as");
+
+	for (int p = 0;p < 3;p++) {
+		vector<BroadPhaseRun> runs;
+		for (int b = 0;b < 5;b++) {
+			if (broadPhases[b] == BROADPHASE_PAIRWISE && agents > pairwiseLimit) {
+				continue;
+			}
+
+			SimulationSettings settings;
+			settings.numCircles = (int)agents;
+			settings.radiusRatio = radiusRatio;
+			settings.boxSize = boxSize;
+			settings.numThreads = threads;
+			settings.seed = seed;
+			settings.placement = placements[p];
+			settings.broadPhase = broadPhases[b];
+
+			Simulation simulation(settings);
+			simulation.createCircles();
+			for (int step = 0;step < warmup;step++) {
+				simulation.circleMotion();
+			}
+
+			Profiler::reset();
+			chrono::steady_clock::time_point start = chrono::steady_clock::now();
+			for (int step = 0;step < steps;step++) {
+				simulation.circleMotion();
+			}
+
+			BroadPhaseRun run;
+			run.placement = placements[p];
+			run.broadPhase = broadPhases[b];
+			run.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+			run.rate = (double)agents * steps / run.seconds;
+			run.broadPhaseSeconds = Profiler::phase(PHASE_BROADPHASE).seconds;
+			run.collisionSeconds = Profiler::phase(PHASE_COLLISION).seconds;
+			runs.push_back(run);
+
+			double agentSteps = (double)agents * steps;
+			printf("%-10s %-12s %10.3f %16.4g %18.2f %18.2f\n", placementName(run.placement), broadPhaseName(run.broadPhase), run.seconds, run.rate, run.broadPhaseSeconds * 1e9 / agentSteps, run.collisionSeconds * 1e9 / agentSteps);
+			fprintf(csv, "%s,%s,%lld,%d,%g,%g,%g,%d,%g,%g,%g,%g\n", placementName(run.placement), broadPhaseName(run.broadPhase), agents, simulation.getNumThreads(), density, radiusRatio, boxSize, steps, run.seconds, run.rate, run.broadPhaseSeconds, run.collisionSeconds);
+			fflush(stdout);
+		}
+
+		size_t fastest = 0;
+		for (size_t r = 1;r < runs.size();r++) {
+			if (runs[r].rate > runs[fastest].rate) {
+				fastest = r;
+			}
+		}
+		printf("fastest for %s: %s\n\n", placementName(placements[p]), broadPhaseName(runs[fastest].broadPhase));
+	}
+
+	fclose(csv);
+	return 0;
+}
@@ -0,0 +1,95 @@
+#include "ContactMatrix.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+using namespace std;
+
+ContactMatrix::ContactMatrix()
+{
+	groups = 0;
+}
+
+//Reads the share and the chances of the group on one line of the file. Returns false if the line isn't a group. A line without a group leaves values empty.
+static bool parseGroup(char* line, vector<double>& values)
+{
+	char* comment = strchr(line, '#');
+	if (comment != NULL) {
+		*comment = '\0';
+	}
+
+	char* cursor = line;
+	while (*cursor == ' ' || *cursor == '\t' || *cursor == '\r' || *cursor == '\n') {
+		cursor++;
+	}
+	if (*cursor == '\0') {
+		return true;
+	}
+	if (strncmp(cursor, "group", 5) != 0) {
+		return false;
+	}
+	cursor += 5;
+
+	while (true) {
+		char* end;
+		double value = strtod(cursor, &end);
+		if (end == cursor) {
+			break;
+		}
+		values.push_back(value);
+		cursor = end;
+	}
+	while (*cursor == ' ' || *cursor == '\t' || *cursor == '\r' || *cursor == '\n') {
+		cursor++;
+	}
+	return *cursor == '\0' && values.size() >= 2;
+}
+
+bool ContactMatrix::load(const char* file)
+{
+	groups = 0;
+	shares.clear();
+	chances.clear();
+
+	FILE* in = fopen(file, "r");
+	if (in == NULL) {
+		return false;
+	}
+
+	vector<double> loadedShares;
+	vector<vector<double> > rows;
+	char line[4096];
+	bool ok = true;
+	while (ok && fgets(line, sizeof(line), in) != NULL) {
+		vector<double> values;
+		ok = parseGroup(line, values);
+		if (ok && !values.empty()) {
+			loadedShares.push_back(values[0]);
+			rows.push_back(vector<double>(values.begin() + 1, values.end()));
+		}
+	}
+	fclose(in);
+
+	//Every group needs a chance for every group, and the shares have to be a distribution
+	size_t count = rows.size();
+	ok = ok && count > 0 && count <= MAX_AGENT_GROUPS;
+	double total = 0;
+	for (size_t g = 0;ok && g < count;g++) {
+		ok = rows[g].size() == count && loadedShares[g] >= 0;
+		total += loadedShares[g];
+		for (size_t h = 0;ok && h < count;h++) {
+			ok = rows[g][h] >= 0 && rows[g][h] <= 1;
+		}
+	}
+	if (!ok || !(total > 0)) {
+		return false;
+	}
+
+	groups = (int)count;
+	for (size_t g = 0;g < count;g++) {
+		shares.push_back(loadedShares[g] / total);
+		chances.insert(chances.end(), rows[g].begin(), rows[g].end());
+	}
+	return true;
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <vector>
+
+//The most agent groups a contact matrix can have, so a group id fits in a byte and the transmission table stays small enough for the cache
+#define MAX_AGENT_GROUPS 16
+
+//Groups of agents (age bands, occupations) that pass the infection on to each other with different chances, loaded from a text file.
+//Every line of the file is one group, in the order of their ids:
+//	group SHARE CHANCE_0 CHANCE_1 ...	the fraction of the population in the group (relative to the other shares), and the chance that an agent of the group infects an agent of each group at distance 0
+//There is one chance for every group in the file. Blank lines and everything after a # are ignored.
+class ContactMatrix
+{
+	int groups;
+	std::vector<double> shares;
+	std::vector<double> chances;
+
+public:
+	ContactMatrix();
+
+	//Reads the groups from file. Returns false (and leaves the matrix empty) if it can't be read or a line doesn't make sense.
+	bool load(const char* file);
+
+	bool empty() const
+	{
+		return groups == 0;
+	}
+
+	int getGroups() const
+	{
+		return groups;
+	}
+
+	//The fraction of the agents in the group. The shares add up to 1.
+	double share(int group) const
+	{
+		return shares[group];
+	}
+
+	//The chance that an agent of group source infects one of group target
+	double chance(int source, int target) const
+	{
+		return chances[source * groups + target];
+	}
+};
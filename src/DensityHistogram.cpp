@@ -0,0 +1,69 @@
+#include "DensityHistogram.h"
+
+using namespace std;
+
+unsigned int DensityHistogram::build(const double* x, const double* y, const unsigned char* state, size_t n, int numStates, double boxSize, int resolution, ThreadPool& pool, vector<unsigned int>& counts)
+{
+	size_t bins = (size_t)resolution * resolution * numStates;
+	int threads = pool.size();
+	counts.resize(bins);
+
+	//The partial histograms are cleared while they are added up, so they only need zeroing when they are first made
+	if (partials.size() != bins * threads) {
+		partials.assign(bins * threads, 0);
+	}
+
+	double scale = resolution / (2 * boxSize);
+	double last = resolution - 1;
+
+	pool.parallelFor(n, pool.grainFor(n), [&](size_t begin, size_t end, int thread) {
+		unsigned int* histogram = partials.data() + thread * bins;
+		unsigned int bin[DENSITY_BLOCK];
+
+		for (size_t block = begin;block < end;block += DENSITY_BLOCK) {
+			size_t count = end - block < DENSITY_BLOCK ? end - block : DENSITY_BLOCK;
+
+			//Works out the bin of every agent of the block first. Without any branches or stores besides bin, the compiler can vectorize this loop.
+			for (size_t k = 0;k < count;k++) {
+				double column = (x[block + k] + boxSize) * scale;
+				double row = (y[block + k] + boxSize) * scale;
+				column = column < 0 ? 0 : column;
+				column = column > last ? last : column;
+				row = row < 0 ? 0 : row;
+				row = row > last ? last : row;
+				bin[k] = ((unsigned int)row * resolution + (unsigned int)column) * numStates + state[block + k];
+			}
+
+			for (size_t k = 0;k < count;k++) {
+				histogram[bin[k]]++;
+			}
+		}
+	});
+
+	//Add up the histograms of every thread, one range of cells per task, and keep track of the fullest cell of each thread
+	vector<unsigned int> peaks(threads, 0);
+	size_t cells = (size_t)resolution * resolution;
+	pool.parallelFor(cells, pool.grainFor(cells), [&](size_t begin, size_t end, int thread) {
+		unsigned int peak = peaks[thread];
+		for (size_t cell = begin;cell < end;cell++) {
+			unsigned int total = 0;
+			for (size_t i = cell * numStates;i < (cell + 1) * numStates;i++) {
+				unsigned int sum = 0;
+				for (int t = 0;t < threads;t++) {
+					sum += partials[t * bins + i];
+					partials[t * bins + i] = 0;
+				}
+				counts[i] = sum;
+				total += sum;
+			}
+			peak = total > peak ? total : peak;
+		}
+		peaks[thread] = peak;
+	});
+
+	unsigned int peak = 0;
+	for (int t = 0;t < threads;t++) {
+		peak = peaks[t] > peak ? peaks[t] : peak;
+	}
+	return peak;
+}
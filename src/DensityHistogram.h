@@ -0,0 +1,21 @@
+#pragma once
+#include <vector>
+#include "ThreadPool.h"
+
+//How many cells a side of the density histogram has
+#define DENSITY_RESOLUTION 256
+
+//Agents binned in a block before their bins get counted
+#define DENSITY_BLOCK 256
+
+//Counts how many agents of each state are in every cell of a fixed grid over the simulation box, for drawing the population as a heatmap when there are too many circles to see.
+//Every thread counts its share of the agents into a histogram of its own, so there are no atomics, and the histograms are added up at the end.
+class DensityHistogram
+{
+	std::vector<unsigned int> partials;
+
+public:
+	//Counts the n agents inside the box [-boxSize, boxSize]^2 into a resolution x resolution grid, with row 0 at -boxSize.
+	//counts gets resolution * resolution * numStates entries, with the states of a cell next to each other. Returns the most agents in a single cell.
+	unsigned int build(const double* x, const double* y, const unsigned char* state, size_t n, int numStates, double boxSize, int resolution, ThreadPool& pool, std::vector<unsigned int>& counts);
+};
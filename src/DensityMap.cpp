@@ -0,0 +1,100 @@
+#include "DensityMap.h"
+#include <cstdio>
+
+using namespace std;
+
+DensityMap::DensityMap()
+{
+	width = 0;
+	height = 0;
+	maxValue = 0;
+}
+
+//Reads the next number of a PGM header, skipping whitespace and # comments
+static bool readHeaderNumber(FILE* file, int& number)
+{
+	int c = fgetc(file);
+	while (c != EOF) {
+		if (c == '#') {
+			while (c != EOF && c != '\n') {
+				c = fgetc(file);
+			}
+		}
+		else if (c != ' ' && c != '\t' && c != '\r' && c != '\n') {
+			break;
+		}
+		c = fgetc(file);
+	}
+	if (c == EOF || c < '0' || c > '9') {
+		return false;
+	}
+	number = 0;
+	while (c >= '0' && c <= '9') {
+		if (number > 100000000) {
+			return false;
+		}
+		number = number * 10 + (c - '0');
+		c = fgetc(file);
+	}
+	//The character after the number is used up too, which after the last number of the header is the single whitespace before binary pixels
+	return true;
+}
+
+bool DensityMap::load(const char* file)
+{
+	values.clear();
+	width = 0;
+	height = 0;
+	maxValue = 0;
+
+	FILE* in = fopen(file, "rb");
+	if (in == NULL) {
+		return false;
+	}
+
+	char magic[2];
+	int fileWidth = 0;
+	int fileHeight = 0;
+	int depth = 0;
+	bool ok = fread(magic, 1, 2, in) == 2 && magic[0] == 'P' && (magic[1] == '2' || magic[1] == '5');
+	ok = ok && readHeaderNumber(in, fileWidth) && readHeaderNumber(in, fileHeight) && readHeaderNumber(in, depth);
+	ok = ok && fileWidth > 0 && fileHeight > 0 && depth > 0 && depth < 65536;
+
+	vector<double> pixels;
+	if (ok) {
+		pixels.resize((size_t)fileWidth * fileHeight);
+		for (size_t i = 0;ok && i < pixels.size();i++) {
+			int value = 0;
+			if (magic[1] == '2') {
+				ok = readHeaderNumber(in, value);
+			}
+			else if (depth < 256) {
+				int c = fgetc(in);
+				ok = c != EOF;
+				value = c;
+			}
+			else {
+				//Two bytes a pixel, most significant first
+				int high = fgetc(in);
+				int low = fgetc(in);
+				ok = low != EOF;
+				value = (high << 8) | low;
+			}
+			pixels[i] = (double)value / depth;
+		}
+	}
+	fclose(in);
+
+	if (!ok) {
+		return false;
+	}
+	width = fileWidth;
+	height = fileHeight;
+	values.swap(pixels);
+	for (size_t i = 0;i < values.size();i++) {
+		if (values[i] > maxValue) {
+			maxValue = values[i];
+		}
+	}
+	return true;
+}
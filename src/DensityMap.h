@@ -0,0 +1,40 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+//A grayscale picture stretched over the simulation box that says where the agents should start: the brighter a pixel, the more agents go there, and black pixels get none.
+//It is read from a PGM file (plain P2 or binary P5), which most image editors can save. The top row of the picture is the top of the box.
+class DensityMap
+{
+	int width;
+	int height;
+	std::vector<double> values;
+	double maxValue;
+
+public:
+	DensityMap();
+
+	//Reads the picture from file. Returns false (and leaves the map empty) if it can't be read.
+	bool load(const char* file);
+
+	bool empty() const
+	{
+		return values.empty();
+	}
+
+	//The brightest value in the map
+	double getMax() const
+	{
+		return maxValue;
+	}
+
+	//The value of the pixel at (u, v), where both run from 0 to 1 over the box from its bottom left corner
+	double at(double u, double v) const
+	{
+		int column = (int)(u * width);
+		int row = (int)((1 - v) * height);
+		column = column < 0 ? 0 : column >= width ? width - 1 : column;
+		row = row < 0 ? 0 : row >= height ? height - 1 : row;
+		return values[(size_t)row * width + column];
+	}
+};
@@ -0,0 +1,193 @@
+#include "DistanceField.h"
+#include <algorithm>
+
+using namespace std;
+
+//The most buckets a side of the box is split into for finding the segments near a node
+#define DISTANCE_FIELD_MAX_BUCKETS 512
+
+DistanceField::DistanceField()
+{
+	resolution = 1;
+	tilesPerSide = 1;
+	origin = -1.0;
+	cellSize = 2.0;
+	inverseCellSize = 0.5;
+	band = 0;
+}
+
+static double segmentDistance(double x, double y, const WallSegment& segment)
+{
+	double alongX = segment.x2 - segment.x1;
+	double alongY = segment.y2 - segment.y1;
+	double lengthSquared = alongX * alongX + alongY * alongY;
+	double t = 0;
+	if (lengthSquared > 0) {
+		t = ((x - segment.x1) * alongX + (y - segment.y1) * alongY) / lengthSquared;
+		t = t < 0 ? 0 : t > 1 ? 1 : t;
+	}
+	double distanceX = x - (segment.x1 + t * alongX);
+	double distanceY = y - (segment.y1 + t * alongY);
+	return sqrt(distanceX * distanceX + distanceY * distanceY);
+}
+
+void DistanceField::build(const ObstacleMap& obstacles, double boxSize, double maxCellSize, double band, ThreadPool& pool)
+{
+	const vector<WallSegment>& segments = obstacles.getSegments();
+	double extent = 2.0 * boxSize;
+	this->band = band;
+
+	resolution = (int)ceil(extent / maxCellSize);
+	resolution = resolution < 1 ? 1 : resolution > DISTANCE_FIELD_MAX_RESOLUTION ? DISTANCE_FIELD_MAX_RESOLUTION : resolution;
+	origin = -boxSize;
+	cellSize = extent / resolution;
+	inverseCellSize = 1.0 / cellSize;
+
+	//A segment goes in every bucket it comes within the band of, so a node only has to look at the segments of its own bucket
+	double bucketWidth = 2.0 * band > cellSize ? 2.0 * band : cellSize;
+	int buckets = (int)(extent / bucketWidth);
+	buckets = buckets < 1 ? 1 : buckets > DISTANCE_FIELD_MAX_BUCKETS ? DISTANCE_FIELD_MAX_BUCKETS : buckets;
+	bucketWidth = extent / buckets;
+	double bucketReach = band + bucketWidth * 0.5 * sqrt(2.0);
+
+	bucketStart.assign((size_t)buckets * buckets + 1, 0);
+	bucketSegments.clear();
+	for (int pass = 0;pass < 2;pass++) {
+		for (size_t s = 0;s < segments.size();s++) {
+			const WallSegment& segment = segments[s];
+			int firstX = (int)floor((min(segment.x1, segment.x2) - band - origin) / bucketWidth);
+			int lastX = (int)floor((max(segment.x1, segment.x2) + band - origin) / bucketWidth);
+			int firstY = (int)floor((min(segment.y1, segment.y2) - band - origin) / bucketWidth);
+			int lastY = (int)floor((max(segment.y1, segment.y2) + band - origin) / bucketWidth);
+			firstX = max(firstX, 0);
+			firstY = max(firstY, 0);
+			lastX = min(lastX, buckets - 1);
+			lastY = min(lastY, buckets - 1);
+
+			for (int row = firstY;row <= lastY;row++) {
+				for (int column = firstX;column <= lastX;column++) {
+					double centerX = origin + (column + 0.5) * bucketWidth;
+					double centerY = origin + (row + 0.5) * bucketWidth;
+					if (segmentDistance(centerX, centerY, segment) > bucketReach) {
+						continue;
+					}
+					size_t bucket = (size_t)row * buckets + column;
+					//The first pass counts the segments of every bucket, the second one puts them in
+					if (pass == 0) {
+						bucketStart[bucket + 1]++;
+					}
+					else {
+						bucketSegments[bucketStart[bucket]++] = (unsigned int)s;
+					}
+				}
+			}
+		}
+
+		if (pass == 0) {
+			for (size_t bucket = 0;bucket < (size_t)buckets * buckets;bucket++) {
+				bucketStart[bucket + 1] += bucketStart[bucket];
+			}
+			bucketSegments.resize(bucketStart[(size_t)buckets * buckets]);
+		}
+		else {
+			//Filling moved every start up to where the next bucket starts
+			for (size_t bucket = (size_t)buckets * buckets;bucket > 0;bucket--) {
+				bucketStart[bucket] = bucketStart[bucket - 1];
+			}
+			bucketStart[0] = 0;
+		}
+	}
+
+	//Every node of the field, row by row from the bottom of the box, before it is split into tiles
+	int side = resolution + 1;
+	vector<float> nodes((size_t)side * side);
+	pool.parallelFor(side, 1, [&](size_t begin, size_t end, int thread) {
+		vector<double> crossings;
+		for (size_t row = begin;row < end;row++) {
+			double y = origin + row * cellSize;
+			int bucketRow = min((int)((y - origin) / bucketWidth), buckets - 1);
+
+			for (int column = 0;column < side;column++) {
+				double x = origin + column * cellSize;
+				int bucketColumn = min((int)((x - origin) / bucketWidth), buckets - 1);
+				size_t bucket = (size_t)bucketRow * buckets + bucketColumn;
+
+				double nearest = band;
+				for (unsigned int k = bucketStart[bucket];k < bucketStart[bucket + 1];k++) {
+					double distance = segmentDistance(x, y, segments[bucketSegments[k]]);
+					nearest = distance < nearest ? distance : nearest;
+				}
+				nodes[row * side + column] = (float)nearest;
+			}
+
+			//Where the row crosses the edges of the solid polygons. The nodes between an odd and an even crossing are inside one.
+			crossings.clear();
+			for (size_t s = 0;s < segments.size();s++) {
+				const WallSegment& segment = segments[s];
+				if (segment.solid && (segment.y1 <= y) != (segment.y2 <= y)) {
+					crossings.push_back(segment.x1 + (y - segment.y1) / (segment.y2 - segment.y1) * (segment.x2 - segment.x1));
+				}
+			}
+			sort(crossings.begin(), crossings.end());
+
+			size_t passed = 0;
+			for (int column = 0;column < side;column++) {
+				double x = origin + column * cellSize;
+				while (passed < crossings.size() && crossings[passed] < x) {
+					passed++;
+				}
+				if (passed % 2 == 1) {
+					nodes[row * side + column] = -nodes[row * side + column];
+				}
+			}
+		}
+	});
+
+	//Keep the tiles with a node within the band of a wall. The others are all band outside or all band inside.
+	tilesPerSide = (resolution + DISTANCE_FIELD_TILE - 1) / DISTANCE_FIELD_TILE;
+	size_t tileCount = (size_t)tilesPerSide * tilesPerSide;
+	float outside = (float)band;
+	tiles.resize(tileCount);
+	pool.parallelFor(tileCount, pool.grainFor(tileCount, 64), [&](size_t begin, size_t end, int thread) {
+		for (size_t t = begin;t < end;t++) {
+			int firstColumn = (int)(t % tilesPerSide) * DISTANCE_FIELD_TILE;
+			int firstRow = (int)(t / tilesPerSide) * DISTANCE_FIELD_TILE;
+			float first = nodes[(size_t)firstRow * side + firstColumn];
+			bool far = first == outside || first == -outside;
+			for (int row = firstRow;far && row <= firstRow + DISTANCE_FIELD_TILE && row < side;row++) {
+				for (int column = firstColumn;far && column <= firstColumn + DISTANCE_FIELD_TILE && column < side;column++) {
+					far = nodes[(size_t)row * side + column] == first;
+				}
+			}
+			tiles[t] = !far ? 0 : first > 0 ? DISTANCE_FIELD_FAR_OUTSIDE : DISTANCE_FIELD_FAR_INSIDE;
+		}
+	});
+
+	unsigned int stored = 0;
+	for (size_t t = 0;t < tileCount;t++) {
+		if (tiles[t] == 0) {
+			tiles[t] = stored;
+			stored += DISTANCE_FIELD_TILE_NODES;
+		}
+	}
+	tileNodes.resize(stored);
+
+	//The nodes past the last row or column of the field, in tiles that stick out of it, repeat the last ones
+	pool.parallelFor(tileCount, pool.grainFor(tileCount, 64), [&](size_t begin, size_t end, int thread) {
+		for (size_t t = begin;t < end;t++) {
+			if (tiles[t] >= DISTANCE_FIELD_FAR_INSIDE) {
+				continue;
+			}
+			int firstColumn = (int)(t % tilesPerSide) * DISTANCE_FIELD_TILE;
+			int firstRow = (int)(t / tilesPerSide) * DISTANCE_FIELD_TILE;
+			float* tile = &tileNodes[tiles[t]];
+			for (int row = 0;row <= DISTANCE_FIELD_TILE;row++) {
+				int nodeRow = firstRow + row < side ? firstRow + row : side - 1;
+				for (int column = 0;column <= DISTANCE_FIELD_TILE;column++) {
+					int nodeColumn = firstColumn + column < side ? firstColumn + column : side - 1;
+					tile[row * (DISTANCE_FIELD_TILE + 1) + column] = nodes[(size_t)nodeRow * side + nodeColumn];
+				}
+			}
+		}
+	});
+}
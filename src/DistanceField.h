@@ -0,0 +1,93 @@
+#pragma once
+#include <cmath>
+#include <vector>
+#include "ObstacleMap.h"
+#include "ThreadPool.h"
+
+//The most cells a side of the distance field gets
+#define DISTANCE_FIELD_MAX_RESOLUTION 2048
+
+//The field is stored in tiles of DISTANCE_FIELD_TILE^2 cells
+#define DISTANCE_FIELD_TILE 8
+#define DISTANCE_FIELD_TILE_NODES ((DISTANCE_FIELD_TILE + 1) * (DISTANCE_FIELD_TILE + 1))
+
+//What a tile without any wall within the band holds instead of an index
+#define DISTANCE_FIELD_FAR_OUTSIDE 0xffffffffu
+#define DISTANCE_FIELD_FAR_INSIDE 0xfffffffeu
+
+//A signed distance field of the obstacles over the simulation box: the distance from every node of a regular grid to the nearest wall, negative inside solid polygons.
+//Looking up the distance and its gradient at an agent's position is a bilinear interpolation of the four nodes around it, so an agent's wall collision costs the same however many segments the layout has.
+//Distances further than the band the field was built with are cut off at the band, as nothing that far from a wall needs to know how far exactly.
+//Most of a layout is further than that from any wall, so the field is split into tiles, and only the tiles near a wall are stored. A lookup in open space only reads the small tile index, which stays in cache, however big the box.
+class DistanceField
+{
+	int resolution;
+	int tilesPerSide;
+	double origin;
+	double cellSize;
+	double inverseCellSize;
+	double band;
+
+	//Where the nodes of every tile start in tileNodes, or one of the far values. Every tile holds its own (DISTANCE_FIELD_TILE + 1)^2 nodes row by row from the bottom, including the ones on its edges, so a cell never needs nodes of another tile.
+	std::vector<unsigned int> tiles;
+	std::vector<float> tileNodes;
+
+	//The segments within the band of each bucket, stored back to back, so every node only measures the segments near it
+	std::vector<unsigned int> bucketStart;
+	std::vector<unsigned int> bucketSegments;
+
+public:
+	DistanceField();
+
+	//Measures the distance from the obstacles at every node of a grid over the box [-boxSize, boxSize]^2 whose cells are at most maxCellSize wide, up to band away from them
+	void build(const ObstacleMap& obstacles, double boxSize, double maxCellSize, double band, ThreadPool& pool);
+
+	void clear()
+	{
+		tiles.clear();
+		tileNodes.clear();
+	}
+
+	bool empty() const
+	{
+		return tiles.empty();
+	}
+
+	//The distance from (x, y) to the nearest wall, and the direction away from it (not normalized)
+	double sample(double x, double y, double& gradientX, double& gradientY) const
+	{
+		double u = (x - origin) * inverseCellSize;
+		double v = (y - origin) * inverseCellSize;
+		int column = (int)std::floor(u);
+		int row = (int)std::floor(v);
+		column = column < 0 ? 0 : column >= resolution ? resolution - 1 : column;
+		row = row < 0 ? 0 : row >= resolution ? resolution - 1 : row;
+		double fx = u - column;
+		double fy = v - row;
+
+		unsigned int tile = tiles[(size_t)(row / DISTANCE_FIELD_TILE) * tilesPerSide + column / DISTANCE_FIELD_TILE];
+		if (tile >= DISTANCE_FIELD_FAR_INSIDE) {
+			gradientX = 0;
+			gradientY = 0;
+			return tile == DISTANCE_FIELD_FAR_OUTSIDE ? band : -band;
+		}
+
+		const float* corner = &tileNodes[tile + (row % DISTANCE_FIELD_TILE) * (DISTANCE_FIELD_TILE + 1) + column % DISTANCE_FIELD_TILE];
+		double d00 = corner[0];
+		double d10 = corner[1];
+		double d01 = corner[DISTANCE_FIELD_TILE + 1];
+		double d11 = corner[DISTANCE_FIELD_TILE + 2];
+
+		gradientX = (d10 - d00) * (1 - fy) + (d11 - d01) * fy;
+		gradientY = (d01 - d00) * (1 - fx) + (d11 - d10) * fx;
+		return (d00 * (1 - fx) + d10 * fx) * (1 - fy) + (d01 * (1 - fx) + d11 * fx) * fy;
+	}
+
+	//Just the distance from (x, y) to the nearest wall
+	double distance(double x, double y) const
+	{
+		double gradientX;
+		double gradientY;
+		return sample(x, y, gradientX, gradientY);
+	}
+};
@@ -0,0 +1,169 @@
+#include "EpidemicHistory.h"
+
+#include <math.h>
+
+using namespace std;
+
+EpidemicHistory::EpidemicHistory()
+{
+	recent.resize(HISTORY_RECENT);
+	buckets.reserve(HISTORY_BUCKETS);
+	clear();
+}
+
+void EpidemicHistory::clear()
+{
+	recentStart = 0;
+	recentCount = 0;
+	buckets.clear();
+	bucketSteps = 1;
+	open.steps = 0;
+}
+
+void EpidemicHistory::add(unsigned long long step, const unsigned long long* counts)
+{
+	CurveSample sample;
+	sample.step = step;
+	for (int i = 0;i < NUM_AGENT_STATES;i++) {
+		sample.counts[i] = (unsigned int)counts[i];
+	}
+
+	//The ring buffer drops the oldest step once it is full
+	if (recentCount < HISTORY_RECENT) {
+		recent[(recentStart + recentCount) % HISTORY_RECENT] = sample;
+		recentCount++;
+	}
+	else {
+		recent[recentStart] = sample;
+		recentStart = (recentStart + 1) % HISTORY_RECENT;
+	}
+
+	if (open.steps == 0) {
+		open.firstStep = step;
+		for (int i = 0;i < NUM_AGENT_STATES;i++) {
+			open.minimum[i] = open.maximum[i] = open.first[i] = sample.counts[i];
+		}
+	}
+	for (int i = 0;i < NUM_AGENT_STATES;i++) {
+		unsigned int count = sample.counts[i];
+		open.minimum[i] = count < open.minimum[i] ? count : open.minimum[i];
+		open.maximum[i] = count > open.maximum[i] ? count : open.maximum[i];
+		open.last[i] = count;
+	}
+	open.steps++;
+
+	if (open.steps == bucketSteps) {
+		closeBucket();
+	}
+}
+
+void EpidemicHistory::closeBucket()
+{
+	buckets.push_back(open);
+	open.steps = 0;
+	if (buckets.size() < HISTORY_BUCKETS) {
+		return;
+	}
+
+	//Out of buckets: merge every pair, which halves the resolution of the whole run and frees half of them
+	size_t merged = 0;
+	for (size_t b = 0;b + 1 < buckets.size();b += 2) {
+		CurveBucket bucket = buckets[b];
+		const CurveBucket& second = buckets[b + 1];
+		bucket.steps += second.steps;
+		for (int i = 0;i < NUM_AGENT_STATES;i++) {
+			bucket.minimum[i] = second.minimum[i] < bucket.minimum[i] ? second.minimum[i] : bucket.minimum[i];
+			bucket.maximum[i] = second.maximum[i] > bucket.maximum[i] ? second.maximum[i] : bucket.maximum[i];
+			bucket.last[i] = second.last[i];
+		}
+		buckets[merged++] = bucket;
+	}
+	buckets.resize(merged);
+	bucketSteps *= 2;
+}
+
+//Largest-triangle-three-buckets: keeps the first and last point, and from every bucket in between the point that makes the largest triangle with the point kept before it and the average of the next bucket
+static void downsample(const vector<float>& x, const vector<float>& y, int points, vector<float>& outX, vector<float>& outY)
+{
+	size_t count = x.size();
+	outX.clear();
+	outY.clear();
+	if (points < 3 || count <= (size_t)points) {
+		outX = x;
+		outY = y;
+		return;
+	}
+
+	double every = (double)(count - 2) / (points - 2);
+	size_t kept = 0;
+	outX.push_back(x[0]);
+	outY.push_back(y[0]);
+
+	for (int b = 0;b < points - 2;b++) {
+		size_t begin = (size_t)(b * every) + 1;
+		size_t end = (size_t)((b + 1) * every) + 1;
+		size_t nextEnd = (size_t)((b + 2) * every) + 1;
+		if (nextEnd > count) {
+			nextEnd = count;
+		}
+
+		double averageX = 0;
+		double averageY = 0;
+		for (size_t i = end;i < nextEnd;i++) {
+			averageX += x[i];
+			averageY += y[i];
+		}
+		size_t nextCount = nextEnd > end ? nextEnd - end : 1;
+		averageX /= nextCount;
+		averageY /= nextCount;
+
+		double largest = -1;
+		size_t chosen = begin;
+		for (size_t i = begin;i < end;i++) {
+			double area = fabs((x[kept] - averageX) * (y[i] - y[kept]) - (x[kept] - x[i]) * (averageY - y[kept]));
+			if (area > largest) {
+				largest = area;
+				chosen = i;
+			}
+		}
+		outX.push_back(x[chosen]);
+		outY.push_back(y[chosen]);
+		kept = chosen;
+	}
+
+	outX.push_back(x[count - 1]);
+	outY.push_back(y[count - 1]);
+}
+
+void EpidemicHistory::plot(EpidemicCurve& curve, int points) const
+{
+	size_t total = buckets.size() + (open.steps > 0 ? 1 : 0);
+	for (int i = 0;i < NUM_AGENT_STATES;i++) {
+		curve.overviewSteps[i].resize(2 * total);
+		curve.overview[i].resize(2 * total);
+	}
+	for (size_t b = 0;b < total;b++) {
+		const CurveBucket& bucket = b < buckets.size() ? buckets[b] : open;
+		float first = (float)bucket.firstStep;
+		float last = (float)(bucket.firstStep + bucket.steps - 1);
+		for (int i = 0;i < NUM_AGENT_STATES;i++) {
+			bool rising = bucket.last[i] >= bucket.first[i];
+			curve.overviewSteps[i][2 * b] = first;
+			curve.overviewSteps[i][2 * b + 1] = last;
+			curve.overview[i][2 * b] = (float)(rising ? bucket.minimum[i] : bucket.maximum[i]);
+			curve.overview[i][2 * b + 1] = (float)(rising ? bucket.maximum[i] : bucket.minimum[i]);
+		}
+	}
+
+	vector<float> steps(recentCount);
+	vector<float> counts(recentCount);
+	for (size_t k = 0;k < recentCount;k++) {
+		steps[k] = (float)recent[(recentStart + k) % HISTORY_RECENT].step;
+	}
+	for (int i = 0;i < NUM_AGENT_STATES;i++) {
+		for (size_t k = 0;k < recentCount;k++) {
+			counts[k] = (float)recent[(recentStart + k) % HISTORY_RECENT].counts[i];
+		}
+		downsample(steps, counts, points, curve.recentSteps[i], curve.recent[i]);
+	}
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include <vector>
+#include "Simulation.h"
+
+//How many of the latest steps are kept at full resolution
+#define HISTORY_RECENT 4096
+
+//How many buckets the whole run is summarized in. Once they are full, neighboring buckets are merged, so each covers twice as many steps.
+#define HISTORY_BUCKETS 1024
+
+//How many points the latest steps are downsampled to for plotting
+#define CURVE_POINTS 512
+
+//The number of agents in each state after one step
+struct CurveSample
+{
+	unsigned long long step;
+	unsigned int counts[NUM_AGENT_STATES];
+};
+
+//The smallest and largest number of agents in each state over a run of steps, and whether the count went up or down over it
+struct CurveBucket
+{
+	unsigned long long firstStep;
+	unsigned long long steps;
+	unsigned int minimum[NUM_AGENT_STATES];
+	unsigned int maximum[NUM_AGENT_STATES];
+	unsigned int first[NUM_AGENT_STATES];
+	unsigned int last[NUM_AGENT_STATES];
+};
+
+//Points ready to be plotted, as steps and counts for each state
+struct EpidemicCurve
+{
+	//The whole run: two points per bucket, the minimum and the maximum, in the order they happened, so a line through them traces the envelope of every step
+	std::vector<float> overviewSteps[NUM_AGENT_STATES];
+	std::vector<float> overview[NUM_AGENT_STATES];
+
+	//The latest steps, downsampled with largest-triangle-three-buckets, which keeps the points that shape the curve the most
+	std::vector<float> recentSteps[NUM_AGENT_STATES];
+	std::vector<float> recent[NUM_AGENT_STATES];
+};
+
+//The number of agents in each state over a run, in memory that doesn't grow with the number of steps.
+//The latest HISTORY_RECENT steps are kept in a ring buffer, and the whole run in at most HISTORY_BUCKETS min-max buckets, so plotting a run of a million steps costs the same as plotting a short one.
+class EpidemicHistory
+{
+	std::vector<CurveSample> recent;
+	size_t recentStart;
+	size_t recentCount;
+
+	std::vector<CurveBucket> buckets;
+	unsigned long long bucketSteps;
+	CurveBucket open;
+
+	void closeBucket();
+
+public:
+	EpidemicHistory();
+
+	void clear();
+	void add(unsigned long long step, const unsigned long long* counts);
+
+	//Fills in the points of curve, with the latest steps downsampled to at most points points
+	void plot(EpidemicCurve& curve, int points) const;
+
+	bool empty() const
+	{
+		return recentCount == 0;
+	}
+
+	const CurveSample& latest() const
+	{
+		return recent[(recentStart + recentCount - 1) % HISTORY_RECENT];
+	}
+};
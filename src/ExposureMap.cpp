@@ -0,0 +1,144 @@
+#include "ExposureMap.h"
+
+using namespace std;
+
+ExposureMap::ExposureMap()
+{
+	capacities[0] = 0;
+	capacities[1] = 0;
+	latest = 0;
+	count = 0;
+}
+
+void ExposureMap::clear()
+{
+	for (int t = 0;t < 2;t++) {
+		tables[t].reset();
+		capacities[t] = 0;
+	}
+	count = 0;
+}
+
+//Makes table hold capacity empty slots
+void ExposureMap::allocate(int table, size_t capacity, ThreadPool& pool)
+{
+	if (capacities[table] != capacity) {
+		tables[table].reset(new Entry[capacity]);
+		capacities[table] = capacity;
+	}
+	Entry* entries = tables[table].get();
+	pool.parallelFor(capacity, pool.grainFor(capacity, 16384), [&](size_t begin, size_t end, int thread) {
+		for (size_t slot = begin;slot < end;slot++) {
+			entries[slot].key.store(0, memory_order_relaxed);
+		}
+	});
+}
+
+bool ExposureMap::insert(Entry* table, size_t capacity, unsigned long long key, float dose, float threshold)
+{
+	size_t mask = capacity - 1;
+	size_t slot = slotOf(key, capacity);
+	for (int probe = 0;probe < EXPOSURE_MAX_PROBE;probe++) {
+		unsigned long long empty = 0;
+		if (table[slot].key.compare_exchange_strong(empty, key, memory_order_relaxed)) {
+			table[slot].dose = dose;
+			table[slot].threshold = threshold;
+			return true;
+		}
+		slot = (slot + 1) & mask;
+	}
+	return false;
+}
+
+void ExposureMap::beginStep(ThreadPool& pool)
+{
+	//A table that never held anything yet has no slots, and finds nothing
+	int previous = latest;
+	latest = 1 - latest;
+	if (capacities[previous] == 0) {
+		allocate(previous, EXPOSURE_MIN_CAPACITY, pool);
+	}
+
+	//Room for four times the pairs of the last step keeps the table at most half full even if twice as many come within reach. A table much bigger than that is shrunk again, so emptying it doesn't cost more than the pairs do.
+	size_t wanted = EXPOSURE_MIN_CAPACITY;
+	while (wanted < 4 * count) {
+		wanted *= 2;
+	}
+	size_t capacity = capacities[latest];
+	if (capacity < wanted || capacity > 4 * wanted) {
+		capacity = wanted;
+	}
+	allocate(latest, capacity, pool);
+
+	threadStored.assign(pool.size() * EXPOSURE_STRIDE, 0);
+	spilledKeys.resize(pool.size());
+	spilledValues.resize(pool.size());
+}
+
+void ExposureMap::endStep(ThreadPool& pool)
+{
+	size_t stored = 0;
+	size_t spilled = 0;
+	for (int t = 0;t < pool.size();t++) {
+		stored += threadStored[t * EXPOSURE_STRIDE];
+		spilled += spilledKeys[t].size();
+	}
+	count = stored;
+	if (spilled == 0) {
+		return;
+	}
+
+	//Move what was stored into a table big enough for everything, then add the rest. This only happens when the pairs grow much faster than from one step to the next.
+	size_t capacity = capacities[latest];
+	while (capacity < 4 * (stored + spilled)) {
+		capacity *= 2;
+	}
+	unique_ptr<Entry[]> old(tables[latest].release());
+	size_t oldCapacity = capacities[latest];
+	capacities[latest] = 0;
+
+	//The table is sized for everything at once, so a probe only runs too long if a lot of keys happen to land close together. Then the table is doubled again rather than losing what the pairs had built up.
+	while (!rebuild(old.get(), oldCapacity, capacity, pool)) {
+		capacity *= 2;
+	}
+	count = stored + spilled;
+
+	for (int t = 0;t < pool.size();t++) {
+		spilledKeys[t].clear();
+		spilledValues[t].clear();
+	}
+}
+
+//Makes the latest table capacity slots big with every pair of old and the spilled ones in it, from every thread at once, as the inserts don't need locks. Returns false if one of them didn't fit.
+bool ExposureMap::rebuild(const Entry* old, size_t oldCapacity, size_t capacity, ThreadPool& pool)
+{
+	allocate(latest, capacity, pool);
+	Entry* table = tables[latest].get();
+
+	//A thread stops at the first pair that doesn't fit, as the table has to be grown and filled again anyway
+	vector<unsigned char> failed(pool.size(), 0);
+	pool.parallelFor(oldCapacity, pool.grainFor(oldCapacity, 16384), [&](size_t begin, size_t end, int thread) {
+		for (size_t slot = begin;slot < end && !failed[thread];slot++) {
+			unsigned long long key = old[slot].key.load(memory_order_relaxed);
+			if (key != 0 && !insert(table, capacity, key, old[slot].dose, old[slot].threshold)) {
+				failed[thread] = 1;
+			}
+		}
+	});
+	pool.parallelFor(spilledKeys.size(), 1, [&](size_t begin, size_t end, int thread) {
+		for (size_t t = begin;t < end;t++) {
+			for (size_t i = 0;i < spilledKeys[t].size() && !failed[thread];i++) {
+				if (!insert(table, capacity, spilledKeys[t][i], spilledValues[t][2 * i], spilledValues[t][2 * i + 1])) {
+					failed[thread] = 1;
+				}
+			}
+		}
+	});
+
+	for (size_t t = 0;t < failed.size();t++) {
+		if (failed[t]) {
+			return false;
+		}
+	}
+	return true;
+}
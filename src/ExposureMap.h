@@ -0,0 +1,108 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "Random.h"
+#include "ThreadPool.h"
+
+//The fewest slots a table of the exposure map gets
+#define EXPOSURE_MIN_CAPACITY 1024
+
+//How many slots a lookup or insert probes before giving up. With the table at most half full a probe is almost always one or two slots long.
+#define EXPOSURE_MAX_PROBE 64
+
+//Entries of the per-thread counters between the counters of two threads, so every thread counts on a cache line of its own
+#define EXPOSURE_STRIDE 8
+
+//How much exposure every pair of agents within reach of each other has built up, keyed by the ids of the pair.
+//Every step stores the pairs that are still within reach into a fresh table and looks up what they had built up in the table of the step before, so a pair that has separated is dropped just by not being stored again. There are no deletions, so there are no tombstones, and nothing ever has to be rehashed to get rid of them.
+//The tables are open addressed with linear probing, and a slot is claimed with a compare-and-swap of its key, so every thread stores its pairs into the same table without locks. A pair is only ever stored by one thread in a step.
+//The table of a step is sized for four times as many pairs as the step before had. A step that stores so many more that a probe runs too long puts the rest aside, and they are added once the table has been grown at the end of the step.
+class ExposureMap
+{
+	struct Entry
+	{
+		std::atomic<unsigned long long> key;
+		float dose;
+		float threshold;
+	};
+
+	std::unique_ptr<Entry[]> tables[2];
+	size_t capacities[2];
+	int latest;
+	size_t count;
+
+	//Pairs stored by each thread in this step, and the ones that didn't fit
+	std::vector<size_t> threadStored;
+	std::vector<std::vector<unsigned long long> > spilledKeys;
+	std::vector<std::vector<float> > spilledValues;
+
+	static size_t slotOf(unsigned long long key, size_t capacity)
+	{
+		return (size_t)mixBits(key) & (capacity - 1);
+	}
+
+	bool insert(Entry* table, size_t capacity, unsigned long long key, float dose, float threshold);
+	void allocate(int table, size_t capacity, ThreadPool& pool);
+	bool rebuild(const Entry* old, size_t oldCapacity, size_t capacity, ThreadPool& pool);
+
+public:
+	ExposureMap();
+
+	//Drops every pair
+	void clear();
+
+	//Makes the pairs stored in the last step the ones find() looks up, and empties the table the pairs of this step are stored into
+	void beginStep(ThreadPool& pool);
+
+	//Adds the pairs that didn't fit in the table during the step, growing it first
+	void endStep(ThreadPool& pool);
+
+	//Looks up the dose the pair had built up by the last step and the dose it gets infected at. Returns false if the pair wasn't within reach in the last step.
+	bool find(unsigned long long key, float& dose, float& threshold) const
+	{
+		int previous = 1 - latest;
+		const Entry* table = tables[previous].get();
+		size_t mask = capacities[previous] - 1;
+		size_t slot = slotOf(key, capacities[previous]);
+		for (int probe = 0;probe < EXPOSURE_MAX_PROBE;probe++) {
+			unsigned long long stored = table[slot].key.load(std::memory_order_relaxed);
+			if (stored == key) {
+				dose = table[slot].dose;
+				threshold = table[slot].threshold;
+				return true;
+			}
+			if (stored == 0) {
+				return false;
+			}
+			slot = (slot + 1) & mask;
+		}
+		return false;
+	}
+
+	//Keeps the pair for the next step. Only the thread looking at the pair may store it, and only once per step.
+	void store(unsigned long long key, float dose, float threshold, int thread)
+	{
+		if (insert(tables[latest].get(), capacities[latest], key, dose, threshold)) {
+			threadStored[thread * EXPOSURE_STRIDE]++;
+			return;
+		}
+		spilledKeys[thread].push_back(key);
+		spilledValues[thread].push_back(dose);
+		spilledValues[thread].push_back(threshold);
+	}
+
+	//The pairs stored in the last step that ended
+	size_t size() const
+	{
+		return count;
+	}
+};
+
+//The key of the pair of agents with the ids a and b, the same whichever order they are given in. It is never 0, as two different ids can't both be 0.
+inline unsigned long long exposureKey(unsigned int a, unsigned int b)
+{
+	unsigned long long first = a < b ? a : b;
+	unsigned long long second = a < b ? b : a;
+	return (first << 32) | second;
+}
@@ -0,0 +1,94 @@
+#include "FrameWriter.h"
+#include "Trace.h"
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "stb_image_write.h"
+
+using namespace std;
+
+FrameWriter::FrameWriter(int numEncoders, size_t maxFrames) : maxFrames(maxFrames > 0 ? maxFrames : 1), encoding(0), failures(0), stopping(false)
+{
+	if (numEncoders < 1) {
+		numEncoders = 1;
+	}
+	for (int i = 0;i < numEncoders;i++) {
+		encoders.push_back(thread(&FrameWriter::encoderLoop, this, i));
+	}
+}
+
+FrameWriter::~FrameWriter()
+{
+	finish();
+	{
+		lock_guard<mutex> guard(lock);
+		stopping = true;
+	}
+	queued.notify_all();
+	for (size_t i = 0;i < encoders.size();i++) {
+		encoders[i].join();
+	}
+}
+
+Frame* FrameWriter::acquire()
+{
+	unique_lock<mutex> guard(lock);
+	if (spare.empty() && frames.size() < maxFrames) {
+		frames.push_back(unique_ptr<Frame>(new Frame()));
+		return frames.back().get();
+	}
+
+	recycled.wait(guard, [&]() { return !spare.empty(); });
+	Frame* frame = spare.back();
+	spare.pop_back();
+	return frame;
+}
+
+void FrameWriter::submit(Frame* frame)
+{
+	{
+		lock_guard<mutex> guard(lock);
+		queue.push_back(frame);
+	}
+	queued.notify_one();
+}
+
+int FrameWriter::finish()
+{
+	unique_lock<mutex> guard(lock);
+	recycled.wait(guard, [&]() { return queue.empty() && encoding == 0; });
+	return failures;
+}
+
+void FrameWriter::encoderLoop(int encoder)
+{
+	string name = "encoder " + to_string(encoder + 1);
+	TraceRecorder::setThreadName(name.c_str());
+
+	unique_lock<mutex> guard(lock);
+	while (true) {
+		queued.wait(guard, [&]() { return stopping || !queue.empty(); });
+		if (queue.empty()) {
+			return;
+		}
+
+		Frame* frame = queue.front();
+		queue.pop_front();
+		encoding++;
+
+		//Encoding is by far the slowest part, and several frames can be encoded at once
+		guard.unlock();
+		bool written;
+		{
+			TRACE_SCOPE("encode");
+			written = stbi_write_png(frame->path.c_str(), frame->width, frame->height, 4, frame->pixels.data(), frame->width * 4) != 0;
+		}
+		guard.lock();
+
+		if (!written) {
+			failures++;
+		}
+		encoding--;
+		spare.push_back(frame);
+		recycled.notify_all();
+	}
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+//One captured image waiting to be written, as rows of RGBA pixels from the top
+struct Frame
+{
+	std::vector<unsigned char> pixels;
+	int width;
+	int height;
+	std::string path;
+};
+
+//Encodes captured frames to PNG files on a pool of background threads, so the thread that renders only has to copy the pixels out.
+//The frames are recycled once written. At most maxFrames exist at a time, and acquire() waits for one to be written when they are all queued, which keeps memory bounded if encoding falls behind.
+class FrameWriter
+{
+	std::vector<std::thread> encoders;
+	std::mutex lock;
+	std::condition_variable queued;
+	std::condition_variable recycled;
+	std::deque<Frame*> queue;
+	std::vector<Frame*> spare;
+	std::vector<std::unique_ptr<Frame>> frames;
+	size_t maxFrames;
+	int encoding;
+	int failures;
+	bool stopping;
+
+	void encoderLoop(int encoder);
+
+public:
+	FrameWriter(int numEncoders, size_t maxFrames);
+	~FrameWriter();
+
+	//A frame to fill in and submit()
+	Frame* acquire();
+
+	//Queues the frame to be written to frame->path
+	void submit(Frame* frame);
+
+	//Waits until every submitted frame has been written, and returns how many of them couldn't be
+	int finish();
+};
@@ -0,0 +1,337 @@
+//Runs the simulation without a window and reports how long each step phase took.
+//This is what the benchmark target runs, and it works on machines without a display.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "Simulation.h"
+#include "Profiler.h"
+
+using namespace std;
+
+static void printUsage(const char* program)
+{
+	printf("usage: %s [--circles N] [--steps N] [--threads N] [--seed N] [--radius R] [--radius-ratio R] [--box B] [--periodic] [--placement uniform|corridor|clustered] [--density-map FILE] [--scatter] [--obstacles FILE] [--stationary F] [--transmission R] [--kernel flat|linear|gaussian] [--dose S] [--airborne Q] [--airborne-intake A] [--airborne-diffusion D] [--airborne-decay R] [--airborne-resolution N] [--groups FILE] [--recovery geometric|gamma|lognormal] [--recovery-variation V] [--latency S] [--presymptomatic S] [--asymptomatic F] [--pairwise] [--verlet] [--sweep] [--hierarchical] [--skin S] [--reorder N] [--counters] [--trace FILE] [--curve FILE] [--until-extinct]\n", program);
+	printf("  --circles N   number of agents (default %d)\n", NUM_CIRCLES);
+	printf("  --steps N     number of simulation steps (default %d)\n", 10 * FRAMERATE);
+	printf("  --threads N   threads to step with, 0 for all hardware threads (default 0)\n");
+	printf("  --seed N      random seed (default: the current time)\n");
+	printf("  --radius R    circle radius (default %g)\n", CIRCLE_RADIUS);
+	printf("  --radius-ratio R  how many times bigger than --radius the biggest circles are, with four times fewer circles in every octave up (default %g)\n", RADIUS_RATIO);
+	printf("  --box B       half-width of the box the agents move in (default %g)\n", BOX_SIZE);
+	printf("  --periodic    make the box wrap around, so agents leaving on one side come back on the other (grid or pairwise only)\n");
+	printf("  --placement P where the agents start: uniform, corridor or clustered (default uniform)\n");
+	printf("  --density-map FILE  place the agents where a grayscale PGM picture stretched over the box is bright\n");
+	printf("  --scatter     place every agent on its own and let the first collision pass push them apart, instead of placing them without overlaps\n");
+	printf("  --obstacles FILE  walls and solid polygons for the agents to bounce off, one per line: wall x1 y1 x2 y2 ... or polygon x1 y1 x2 y2 x3 y3 ...\n");
+	printf("  --stationary F  fraction of the agents that stay where they are placed, as with social distancing (not with --verlet or --sweep, default %g)\n", STATIONARY_FRACTION);
+	printf("  --transmission R  distance between centers the infection is passed on over, 0 to only pass it on when touching (default %g)\n", TRANSMISSION_RADIUS);
+	printf("  --kernel K    how the chance of passing it on falls off with the distance: flat, linear or gaussian (default flat)\n");
+	printf("  --dose S      pass it on once a pair has been within reach for an exponentially distributed time with a mean of S seconds (weighted by the chance and kernel), instead of with a chance every step (default %g)\n", INFECTIOUS_DOSE);
+	printf("  --airborne Q  quanta per second every infectious agent breathes out into the air, which carries them across the box and infects whoever breathes them in, 0 for none (default %g)\n", AIRBORNE_EMISSION);
+	printf("  --airborne-intake A  area of air an agent breathes in per second (default %g)\n", AIRBORNE_INTAKE);
+	printf("  --airborne-diffusion D  how fast the air spreads, in area per second (default %g)\n", AIRBORNE_DIFFUSION);
+	printf("  --airborne-decay R  fraction of the air cleared out per second by ventilation and settling (default %g)\n", AIRBORNE_DECAY);
+	printf("  --airborne-resolution N  cells a side of the grid the air is tracked on (default %d)\n", AIRBORNE_RESOLUTION);
+	printf("  --groups FILE  agent groups that infect each other with their own chances, one per line: group SHARE CHANCE_0 CHANCE_1 ...\n");
+	printf("  --recovery D  how long agents stay infected: geometric, gamma or lognormal (default geometric)\n");
+	printf("  --recovery-variation V  standard deviation of the gamma and lognormal durations relative to their mean (default %g)\n", RECOVERY_VARIATION);
+	printf("  --latency S   mean seconds an infected agent is exposed before it is infectious, 0 for none (default %g)\n", AVG_LATENCY);
+	printf("  --presymptomatic S  mean seconds an agent is infectious before it shows symptoms, 0 for none (default %g)\n", AVG_PRESYMPTOMATIC);
+	printf("  --asymptomatic F  fraction of the infections that never show symptoms (default %g)\n", ASYMPTOMATIC_FRACTION);
+	printf("  --pairwise    compare every pair of agents instead of using the grid\n");
+	printf("  --verlet      reuse per-agent neighbor lists until an agent has moved more than half the skin\n");
+	printf("  --sweep       sort the agents along one axis and sweep along it instead of using the grid\n");
+	printf("  --hierarchical  bucket the agents into one grid per octave of radius instead of a single grid\n");
+	printf("  --skin S      how much further than the reach the neighbor lists look (default %g)\n", VERLET_SKIN);
+	printf("  --reorder N   sort the agents along a Morton curve every N steps, 0 never (default %d)\n", REORDER_INTERVAL);
+	printf("  --counters    sample hardware performance counters around every step phase\n");
+	printf("  --trace FILE  record a Chrome trace of the run into FILE\n");
+	printf("  --curve FILE  write the number of agents in each state after every step into FILE as CSV\n");
+	printf("  --until-extinct  stop early once no agent is infected anymore\n");
+}
+
+int main(int argc, char** argv)
+{
+	SimulationSettings settings;
+	int steps = 10 * FRAMERATE;
+	bool counters = false;
+	const char* traceFile = NULL;
+	const char* curveFile = NULL;
+	bool untilExtinct = false;
+
+	for (int i = 1;i < argc;i++) {
+		if (strcmp(argv[i], "--circles") == 0 && i + 1 < argc) {
+			settings.numCircles = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--steps") == 0 && i + 1 < argc) {
+			steps = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+			settings.numThreads = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+			settings.seed = strtoull(argv[++i], NULL, 10);
+		}
+		else if (strcmp(argv[i], "--radius") == 0 && i + 1 < argc) {
+			settings.circleRadius = atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--radius-ratio") == 0 && i + 1 < argc) {
+			settings.radiusRatio = atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--box") == 0 && i + 1 < argc) {
+			settings.boxSize = atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--stationary") == 0 && i + 1 < argc) {
+			settings.stationaryFraction = atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--periodic") == 0) {
+			settings.periodic = true;
+		}
+		else if (strcmp(argv[i], "--placement") == 0 && i + 1 < argc) {
+			i++;
+			if (strcmp(argv[i], "uniform") == 0) {
+				settings.placement = PLACEMENT_UNIFORM;
+			}
+			else if (strcmp(argv[i], "corridor") == 0) {
+				settings.placement = PLACEMENT_CORRIDOR;
+			}
+			else if (strcmp(argv[i], "clustered") == 0) {
+				settings.placement = PLACEMENT_CLUSTERED;
+			}
+			else {
+				printUsage(argv[0]);
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "--density-map") == 0 && i + 1 < argc) {
+			i++;
+			if (!settings.densityMap.load(argv[i])) {
+				fprintf(stderr, "Failed to read %s\n", argv[i]);
+				return 1;
+			}
+			settings.placement = PLACEMENT_DENSITY_MAP;
+		}
+		else if (strcmp(argv[i], "--scatter") == 0) {
+			settings.spacedPlacement = false;
+		}
+		else if (strcmp(argv[i], "--obstacles") == 0 && i + 1 < argc) {
+			i++;
+			if (!settings.obstacles.load(argv[i])) {
+				fprintf(stderr, "Failed to read %s\n", argv[i]);
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "--transmission") == 0 && i + 1 < argc) {
+			settings.transmissionRadius = atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--kernel") == 0 && i + 1 < argc) {
+			i++;
+			if (strcmp(argv[i], "flat") == 0) {
+				settings.transmissionKernel = KERNEL_FLAT;
+			}
+			else if (strcmp(argv[i], "linear") == 0) {
+				settings.transmissionKernel = KERNEL_LINEAR;
+			}
+			else if (strcmp(argv[i], "gaussian") == 0) {
+				settings.transmissionKernel = KERNEL_GAUSSIAN;
+			}
+			else {
+				printUsage(argv[0]);
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "--dose") == 0 && i + 1 < argc) {
+			settings.infectiousDose = atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--airborne") == 0 && i + 1 < argc) {
+			settings.airborneEmission = atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--airborne-intake") == 0 && i + 1 < argc) {
+			settings.airborneIntake = atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--airborne-diffusion") == 0 && i + 1 < argc) {
+			settings.airborneDiffusion = atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--airborne-decay") == 0 && i + 1 < argc) {
+			settings.airborneDecay = atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--airborne-resolution") == 0 && i + 1 < argc) {
+			settings.airborneResolution = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--groups") == 0 && i + 1 < argc) {
+			i++;
+			if (!settings.contacts.load(argv[i])) {
+				fprintf(stderr, "Failed to read %s\n", argv[i]);
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "--recovery") == 0 && i + 1 < argc) {
+			i++;
+			if (strcmp(argv[i], "geometric") == 0) {
+				settings.recoveryDistribution = RECOVERY_GEOMETRIC;
+			}
+			else if (strcmp(argv[i], "gamma") == 0) {
+				settings.recoveryDistribution = RECOVERY_GAMMA;
+			}
+			else if (strcmp(argv[i], "lognormal") == 0) {
+				settings.recoveryDistribution = RECOVERY_LOGNORMAL;
+			}
+			else {
+				printUsage(argv[0]);
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "--recovery-variation") == 0 && i + 1 < argc) {
+			settings.recoveryVariation = atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--latency") == 0 && i + 1 < argc) {
+			settings.avgLatency = atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--presymptomatic") == 0 && i + 1 < argc) {
+			settings.avgPresymptomatic = atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--asymptomatic") == 0 && i + 1 < argc) {
+			settings.asymptomaticFraction = atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--pairwise") == 0) {
+			settings.broadPhase = BROADPHASE_PAIRWISE;
+		}
+		else if (strcmp(argv[i], "--verlet") == 0) {
+			settings.broadPhase = BROADPHASE_VERLET;
+		}
+		else if (strcmp(argv[i], "--sweep") == 0) {
+			settings.broadPhase = BROADPHASE_SWEEP;
+		}
+		else if (strcmp(argv[i], "--hierarchical") == 0) {
+			settings.broadPhase = BROADPHASE_HIERARCHICAL;
+		}
+		else if (strcmp(argv[i], "--skin") == 0 && i + 1 < argc) {
+			settings.verletSkin = atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--reorder") == 0 && i + 1 < argc) {
+			settings.reorderInterval = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--counters") == 0) {
+			counters = true;
+		}
+		else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+			traceFile = argv[++i];
+		}
+		else if (strcmp(argv[i], "--curve") == 0 && i + 1 < argc) {
+			curveFile = argv[++i];
+		}
+		else if (strcmp(argv[i], "--until-extinct") == 0) {
+			untilExtinct = true;
+		}
+		else {
+			printUsage(argv[0]);
+			return strcmp(argv[i], "--help") == 0 ? 0 : 1;
+		}
+	}
+
+	if (settings.numCircles < 1 || steps < 1 || settings.circleRadius <= 0 || !(settings.radiusRatio >= 1) || settings.boxSize <= settings.circleRadius * settings.radiusRatio || settings.verletSkin < 0 || !(settings.stationaryFraction >= 0 && settings.stationaryFraction <= 1) || !(settings.infectiousDose >= 0) || !(settings.airborneEmission >= 0) || !(settings.airborneIntake >= 0) || !(settings.airborneDiffusion >= 0) || !(settings.airborneDecay >= 0) || settings.airborneResolution < 1 || !(settings.avgLatency >= 0) || !(settings.avgPresymptomatic >= 0) || !(settings.asymptomaticFraction >= 0 && settings.asymptomaticFraction <= 1)) {
+		printUsage(argv[0]);
+		return 1;
+	}
+	if (settings.periodic && settings.broadPhase != BROADPHASE_GRID && settings.broadPhase != BROADPHASE_PAIRWISE) {
+		fprintf(stderr, "--periodic only works with the grid or --pairwise\n");
+		printUsage(argv[0]);
+		return 1;
+	}
+	if (settings.stationaryFraction > 0 && (settings.broadPhase == BROADPHASE_VERLET || settings.broadPhase == BROADPHASE_SWEEP)) {
+		fprintf(stderr, "--stationary doesn't work with --verlet or --sweep\n");
+		printUsage(argv[0]);
+		return 1;
+	}
+
+	TraceRecorder::setThreadName("main");
+	Profiler::enableCounters(counters);
+	if (counters && !PerfCounters::available(COUNTER_CYCLES)) {
+		fprintf(stderr, "Hardware performance counters are not available (check /proc/sys/kernel/perf_event_paranoid)\n");
+	}
+
+	FILE* curve = NULL;
+	if (curveFile != NULL) {
+		curve = fopen(curveFile, "w");
+		if (curve == NULL) {
+			fprintf(stderr, "Failed to open %s\n", curveFile);
+			return 1;
+		}
+		fprintf(curve, "step,susceptible,exposed,presymptomatic,asymptomatic,infected,recovered\n");
+	}
+
+	Simulation simulation(settings);
+	chrono::steady_clock::time_point setupStart = chrono::steady_clock::now();
+	simulation.createCircles();
+	double setupSeconds = chrono::duration<double>(chrono::steady_clock::now() - setupStart).count();
+	unsigned long long initialBuilds = simulation.getNeighborListBuilds();
+
+	if (traceFile != NULL) {
+		TraceRecorder::start();
+	}
+	Profiler::reset();
+
+	//The state counts are kept up to date by the step itself, so recording them and checking for the end of the outbreak cost nothing per agent
+	const unsigned long long* states = simulation.getStateCounts();
+	if (curve != NULL) {
+		fprintf(curve, "0,%llu,%llu,%llu,%llu,%llu,%llu\n", states[SUSCEPTIBLE], states[EXPOSED], states[PRESYMPTOMATIC], states[ASYMPTOMATIC], states[INFECTED], states[RECOVERED]);
+	}
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	int stepsRun = 0;
+	while (stepsRun < steps && !(untilExtinct && activeInfections(states) == 0)) {
+		{
+			PROFILE_PHASE(PHASE_STEP);
+			simulation.circleMotion();
+		}
+		stepsRun++;
+		if (curve != NULL) {
+			fprintf(curve, "%d,%llu,%llu,%llu,%llu,%llu,%llu\n", stepsRun, states[SUSCEPTIBLE], states[EXPOSED], states[PRESYMPTOMATIC], states[ASYMPTOMATIC], states[INFECTED], states[RECOVERED]);
+		}
+	}
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	if (traceFile != NULL && !TraceRecorder::stop(traceFile)) {
+		fprintf(stderr, "Failed to write %s\n", traceFile);
+	}
+
+	if (curve != NULL) {
+		fclose(curve);
+	}
+
+	double agentSteps = (double)settings.numCircles * stepsRun;
+	printf("%d agents, %d steps, %d threads, %.3f s, %.0f agent-steps/s\n", settings.numCircles, stepsRun, simulation.getNumThreads(), seconds, agentSteps / seconds);
+	printf("susceptible %llu, infected %llu, recovered %llu", states[SUSCEPTIBLE], states[INFECTED], states[RECOVERED]);
+	if (settings.avgLatency > 0 || settings.avgPresymptomatic > 0 || settings.asymptomaticFraction > 0) {
+		printf(", exposed %llu, presymptomatic %llu, asymptomatic %llu", states[EXPOSED], states[PRESYMPTOMATIC], states[ASYMPTOMATIC]);
+	}
+	if (settings.infectiousDose > 0) {
+		printf(", %zu pairs building up a dose", simulation.getExposedPairs());
+	}
+	if (settings.airborneEmission > 0) {
+		printf(", peak airborne concentration %g", simulation.getAirborne().getPeak());
+	}
+	printf("\n");
+	printf("set up in %.3f s", setupSeconds);
+	if (!settings.obstacles.empty()) {
+		printf(", %zu wall segments", settings.obstacles.getSegments().size());
+	}
+	if (!settings.contacts.empty()) {
+		printf(", %d agent groups", settings.contacts.getGroups());
+	}
+	if (simulation.getCrowdedAgents() > 0) {
+		printf(", %zu agents didn't fit without overlapping", simulation.getCrowdedAgents());
+	}
+	printf("\n");
+	if (settings.broadPhase == BROADPHASE_VERLET) {
+		unsigned long long builds = simulation.getNeighborListBuilds() - initialBuilds;
+		printf("neighbor lists rebuilt %llu times, every %.1f steps\n", builds, builds > 0 ? (double)stepsRun / builds : 0.0);
+	}
+	printf("\n");
+	Profiler::printReport(stdout, agentSteps);
+
+	return 0;
+}
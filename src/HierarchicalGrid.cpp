@@ -0,0 +1,84 @@
+#include "HierarchicalGrid.h"
+
+using namespace std;
+
+HierarchicalGrid::HierarchicalGrid()
+{
+	for (int l = 0;l < HIERARCHY_LEVELS;l++) {
+		levelRadius[l] = 0;
+	}
+}
+
+void HierarchicalGrid::build(const double* x, const double* y, const double* radius, size_t n, double boxSize, double minRadius, ThreadPool& pool)
+{
+	//The biggest radius that still goes into each level
+	double bound[HIERARCHY_LEVELS];
+	for (int l = 0;l < HIERARCHY_LEVELS;l++) {
+		bound[l] = minRadius * (2 << l);
+	}
+
+	size_t blockSize = pool.grainFor(n);
+	size_t blocks = (n + blockSize - 1) / blockSize;
+	agentLevel.resize(n);
+	blockLevels.assign(blocks * HIERARCHY_LEVELS, 0);
+	blockRadius.assign(blocks * HIERARCHY_LEVELS, 0.0);
+
+	//Find every agent's level, and count the agents and the biggest radius of each level in every block
+	pool.parallelFor(blocks, 1, [&](size_t begin, size_t end, int thread) {
+		for (size_t block = begin;block < end;block++) {
+			unsigned int* counts = &blockLevels[block * HIERARCHY_LEVELS];
+			double* biggest = &blockRadius[block * HIERARCHY_LEVELS];
+			size_t last = (block + 1) * blockSize < n ? (block + 1) * blockSize : n;
+			for (size_t i = block * blockSize;i < last;i++) {
+				int level = 0;
+				while (level < HIERARCHY_LEVELS - 1 && radius[i] > bound[level]) {
+					level++;
+				}
+				agentLevel[i] = (unsigned char)level;
+				counts[level]++;
+				if (radius[i] > biggest[level]) {
+					biggest[level] = radius[i];
+				}
+			}
+		}
+	});
+
+	//Every level's agents go in block order, so each level keeps the agents in index order
+	for (int l = 0;l < HIERARCHY_LEVELS;l++) {
+		unsigned int total = 0;
+		double biggest = 0;
+		for (size_t block = 0;block < blocks;block++) {
+			unsigned int count = blockLevels[block * HIERARCHY_LEVELS + l];
+			blockLevels[block * HIERARCHY_LEVELS + l] = total;
+			total += count;
+			if (blockRadius[block * HIERARCHY_LEVELS + l] > biggest) {
+				biggest = blockRadius[block * HIERARCHY_LEVELS + l];
+			}
+		}
+		levelAgents[l].resize(total);
+		levelX[l].resize(total);
+		levelY[l].resize(total);
+		levelRadius[l] = biggest;
+	}
+
+	pool.parallelFor(blocks, 1, [&](size_t begin, size_t end, int thread) {
+		for (size_t block = begin;block < end;block++) {
+			unsigned int* slots = &blockLevels[block * HIERARCHY_LEVELS];
+			size_t last = (block + 1) * blockSize < n ? (block + 1) * blockSize : n;
+			for (size_t i = block * blockSize;i < last;i++) {
+				int level = agentLevel[i];
+				unsigned int slot = slots[level]++;
+				levelAgents[level][slot] = (unsigned int)i;
+				levelX[level][slot] = x[i];
+				levelY[level][slot] = y[i];
+			}
+		}
+	});
+
+	//The cells of each level are as wide as its biggest circle, so a lookup for a circle no bigger than that only visits the cells around it
+	for (int l = 0;l < HIERARCHY_LEVELS;l++) {
+		if (!levelAgents[l].empty()) {
+			levels[l].build(levelX[l].data(), levelY[l].data(), levelAgents[l].size(), boxSize, 2.0 * levelRadius[l], pool);
+		}
+	}
+}
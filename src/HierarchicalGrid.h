@@ -0,0 +1,71 @@
+#pragma once
+#include <vector>
+#include "SpatialGrid.h"
+#include "ThreadPool.h"
+
+//Levels of the hierarchy. Level l holds the circles up to 2^(l + 1) times the smallest radius, so 8 levels cover radii up to 256 times apart, and anything bigger goes in the top level.
+#define HIERARCHY_LEVELS 8
+
+//A stack of uniform grids, one per octave of circle radius, used as the broad phase when the radii are very different.
+//A single grid needs cells as wide as the biggest circle, so a few big circles (vehicles, zones) put hundreds of small ones (people) in every cell. Here every circle is bucketed into the grid whose cells fit it, and a lookup visits each level with a range widened by the biggest radius on that level, so small circles are only compared with what is near them on every level.
+//Every level is a SpatialGrid over the circles binned into it, so it is rebuilt in parallel the same way.
+class HierarchicalGrid
+{
+	SpatialGrid levels[HIERARCHY_LEVELS];
+
+	//The agents binned into each level in index order, and where they are, so every level's grid is built from arrays of its own
+	std::vector<unsigned int> levelAgents[HIERARCHY_LEVELS];
+	std::vector<double> levelX[HIERARCHY_LEVELS];
+	std::vector<double> levelY[HIERARCHY_LEVELS];
+
+	//The biggest radius actually binned into each level
+	double levelRadius[HIERARCHY_LEVELS];
+
+	std::vector<unsigned char> agentLevel;
+
+	//The count, and then the next free slot, of every level in every block of agents, and the biggest radius of every level in every block
+	std::vector<unsigned int> blockLevels;
+	std::vector<double> blockRadius;
+
+public:
+	HierarchicalGrid();
+
+	//Bins the n agents inside the box [-boxSize, boxSize]^2 by their radius, starting from minRadius for the first level, and builds the grid of every level that got agents
+	void build(const double* x, const double* y, const double* radius, size_t n, double boxSize, double minRadius, ThreadPool& pool);
+
+	//How many agents went into level l in the last build
+	size_t levelSize(int l) const
+	{
+		return levelAgents[l].size();
+	}
+
+	//Calls visit(j) for every agent j whose circle might overlap the circle of the given radius around (x, y), including that circle's agent itself
+	template<class F>
+	void forEachOverlapping(double x, double y, double radius, const F& visit) const
+	{
+		for (int l = 0;l < HIERARCHY_LEVELS;l++) {
+			if (levelAgents[l].empty()) {
+				continue;
+			}
+			const unsigned int* agents = levelAgents[l].data();
+			levels[l].forEachInRange(x, y, radius + levelRadius[l], [&](unsigned int k) {
+				visit(agents[k]);
+			});
+		}
+	}
+
+	//Calls visit(j) for every agent j on any level in the cells overlapping the square of half-width range around (x, y), which holds every agent whose center is closer than range
+	template<class F>
+	void forEachInRange(double x, double y, double range, const F& visit) const
+	{
+		for (int l = 0;l < HIERARCHY_LEVELS;l++) {
+			if (levelAgents[l].empty()) {
+				continue;
+			}
+			const unsigned int* agents = levelAgents[l].data();
+			levels[l].forEachInRange(x, y, range, [&](unsigned int k) {
+				visit(agents[k]);
+			});
+		}
+	}
+};
@@ -0,0 +1,128 @@
+#include "InstanceStream.h"
+#include <cstring>
+
+//Supported through the core version, or through the extension on older contexts
+static bool bufferStorageSupported()
+{
+	if (glBufferStorage == NULL) {
+		return false;
+	}
+	if (gl3w_is_supported(4, 4)) {
+		return true;
+	}
+
+	int extensions = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &extensions);
+	for (int i = 0;i < extensions;i++) {
+		const char* name = (const char*)glGetStringi(GL_EXTENSIONS, i);
+		if (name != NULL && strcmp(name, "GL_ARB_buffer_storage") == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+InstanceStream::InstanceStream()
+{
+	buffer = 0;
+	regionCapacity = 0;
+	for (int i = 0;i < INSTANCE_REGIONS;i++) {
+		fences[i] = NULL;
+	}
+	persistentMemory = NULL;
+	persistent = false;
+}
+
+void InstanceStream::create(size_t capacity)
+{
+	persistent = bufferStorageSupported();
+	regionCapacity = capacity > 0 ? capacity : 1;
+	size_t size = INSTANCE_REGIONS * regionCapacity * sizeof(CircleInstance);
+
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	if (persistent) {
+		//Coherent mapping means writes become visible to the GPU without flushing, as long as they happen before the draw is issued
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_ARRAY_BUFFER, size, NULL, flags);
+		persistentMemory = (unsigned char*)glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags);
+	}
+	else {
+		glBufferData(GL_ARRAY_BUFFER, size, NULL, GL_STREAM_DRAW);
+		for (int i = 0;i < INSTANCE_REGIONS;i++) {
+			staging[i].resize(regionCapacity);
+		}
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void InstanceStream::destroy()
+{
+	//The GPU may still be reading any of the regions
+	for (int i = 0;i < INSTANCE_REGIONS;i++) {
+		waitForRegion(i);
+		staging[i].clear();
+	}
+
+	if (buffer != 0) {
+		if (persistentMemory != NULL) {
+			glBindBuffer(GL_ARRAY_BUFFER, buffer);
+			glUnmapBuffer(GL_ARRAY_BUFFER);
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
+			persistentMemory = NULL;
+		}
+		glDeleteBuffers(1, &buffer);
+		buffer = 0;
+	}
+}
+
+void InstanceStream::waitForRegion(int region)
+{
+	if (fences[region] == NULL) {
+		return;
+	}
+
+	//Usually already signaled, since the region was drawn at least a frame ago
+	GLenum result = glClientWaitSync(fences[region], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+	while (result == GL_TIMEOUT_EXPIRED) {
+		result = glClientWaitSync(fences[region], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+	}
+	glDeleteSync(fences[region]);
+	fences[region] = NULL;
+}
+
+CircleInstance* InstanceStream::getRegion(int region)
+{
+	if (persistent) {
+		return (CircleInstance*)(persistentMemory + getOffset(region));
+	}
+	return staging[region].data();
+}
+
+void InstanceStream::upload(int region, size_t count)
+{
+	if (persistent || count == 0) {
+		return;
+	}
+	if (count > regionCapacity) {
+		count = regionCapacity;
+	}
+
+	//The region isn't being drawn from anymore, so there is nothing for the driver to synchronize with
+	waitForRegion(region);
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	void* memory = glMapBufferRange(GL_ARRAY_BUFFER, getOffset(region), count * sizeof(CircleInstance), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+	if (memory != NULL) {
+		memcpy(memory, staging[region].data(), count * sizeof(CircleInstance));
+		glUnmapBuffer(GL_ARRAY_BUFFER);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void InstanceStream::fence(int region)
+{
+	if (fences[region] != NULL) {
+		glDeleteSync(fences[region]);
+	}
+	fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
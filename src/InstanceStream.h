@@ -0,0 +1,55 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include "GL/gl3w.h"
+#include "Simulation.h"
+
+//How many regions the instance buffer is split into: one for each slot of the snapshot triple buffer, so the simulation writes one while the GPU draws another
+#define INSTANCE_REGIONS 3
+
+//Holds the per-circle instance data of the snapshots the simulation thread publishes.
+//Each region belongs to one slot of the triple buffer. The renderer puts a fence after the draw calls that read a region, and waits for it before handing the region back to the simulation, so the simulation never writes memory the GPU is still reading.
+//When the driver supports buffer storage (OpenGL 4.4 or ARB_buffer_storage), the whole buffer stays mapped for its lifetime and the simulation writes straight into it. Otherwise the simulation writes into a copy in main memory, and upload() copies a region over when the renderer picks it up.
+class InstanceStream
+{
+	unsigned int buffer;
+	size_t regionCapacity;
+	GLsync fences[INSTANCE_REGIONS];
+	unsigned char* persistentMemory;
+	std::vector<CircleInstance> staging[INSTANCE_REGIONS];
+	bool persistent;
+
+public:
+	InstanceStream();
+
+	//Needs a current OpenGL context. Every region has room for capacity instances.
+	void create(size_t capacity);
+	void destroy();
+
+	bool isPersistent() const
+	{
+		return persistent;
+	}
+
+	//Where the instances of a region get written. Can be written from any thread, as long as the GPU is done with the region.
+	CircleInstance* getRegion(int region);
+
+	//Makes the first count instances written to the region visible to the GPU. Nothing to do when the buffer is persistently mapped.
+	void upload(int region, size_t count);
+
+	//Waits for the GPU to finish the draw calls that read the region
+	void waitForRegion(int region);
+
+	//Call after the draw calls that read the region have been issued
+	void fence(int region);
+
+	//The buffer and the byte offset of a region, for pointing the instance attributes at it
+	unsigned int getBuffer() const
+	{
+		return buffer;
+	}
+	size_t getOffset(int region) const
+	{
+		return region * regionCapacity * sizeof(CircleInstance);
+	}
+};
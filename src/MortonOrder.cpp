@@ -0,0 +1,82 @@
+#include "MortonOrder.h"
+
+using namespace std;
+
+#define RADIX_DIGITS (1 << RADIX_BITS)
+
+//Spreads the low 16 bits of v out to the even bits
+static unsigned int spreadBits(unsigned int v)
+{
+	v &= 0xffff;
+	v = (v | (v << 8)) & 0x00ff00ff;
+	v = (v | (v << 4)) & 0x0f0f0f0f;
+	v = (v | (v << 2)) & 0x33333333;
+	v = (v | (v << 1)) & 0x55555555;
+	return v;
+}
+
+void MortonOrder::sort(const double* x, const double* y, size_t n, double boxSize, ThreadPool& pool, vector<unsigned int>& order)
+{
+	keys.resize(n);
+	keysScratch.resize(n);
+	order.resize(n);
+	orderScratch.resize(n);
+
+	size_t blockSize = pool.grainFor(n);
+	size_t blocks = (n + blockSize - 1) / blockSize;
+	blockDigits.resize(blocks * RADIX_DIGITS);
+
+	//Agents outside the box (there shouldn't be any) go in the cells at its edge
+	double scale = (1 << MORTON_BITS) / (2.0 * boxSize);
+	unsigned int maxCell = (1 << MORTON_BITS) - 1;
+	pool.parallelFor(n, blockSize, [&](size_t begin, size_t end, int thread) {
+		for (size_t i = begin;i < end;i++) {
+			double cellX = (x[i] + boxSize) * scale;
+			double cellY = (y[i] + boxSize) * scale;
+			unsigned int column = cellX <= 0 ? 0 : cellX >= maxCell ? maxCell : (unsigned int)cellX;
+			unsigned int row = cellY <= 0 ? 0 : cellY >= maxCell ? maxCell : (unsigned int)cellY;
+			keys[i] = spreadBits(column) | (spreadBits(row) << 1);
+			order[i] = (unsigned int)i;
+		}
+	});
+
+	for (int shift = 0;shift < 2 * MORTON_BITS;shift += RADIX_BITS) {
+		pool.parallelFor(blocks, 1, [&](size_t begin, size_t end, int thread) {
+			for (size_t block = begin;block < end;block++) {
+				unsigned int* digits = &blockDigits[block * RADIX_DIGITS];
+				for (int d = 0;d < RADIX_DIGITS;d++) {
+					digits[d] = 0;
+				}
+				size_t last = (block + 1) * blockSize < n ? (block + 1) * blockSize : n;
+				for (size_t i = block * blockSize;i < last;i++) {
+					digits[(keys[i] >> shift) & (RADIX_DIGITS - 1)]++;
+				}
+			}
+		});
+
+		//All agents with a smaller digit go first, then the ones with the same digit in earlier blocks
+		unsigned int total = 0;
+		for (int d = 0;d < RADIX_DIGITS;d++) {
+			for (size_t block = 0;block < blocks;block++) {
+				unsigned int count = blockDigits[block * RADIX_DIGITS + d];
+				blockDigits[block * RADIX_DIGITS + d] = total;
+				total += count;
+			}
+		}
+
+		pool.parallelFor(blocks, 1, [&](size_t begin, size_t end, int thread) {
+			for (size_t block = begin;block < end;block++) {
+				unsigned int* slots = &blockDigits[block * RADIX_DIGITS];
+				size_t last = (block + 1) * blockSize < n ? (block + 1) * blockSize : n;
+				for (size_t i = block * blockSize;i < last;i++) {
+					unsigned int slot = slots[(keys[i] >> shift) & (RADIX_DIGITS - 1)]++;
+					keysScratch[slot] = keys[i];
+					orderScratch[slot] = order[i];
+				}
+			}
+		});
+
+		keys.swap(keysScratch);
+		order.swap(orderScratch);
+	}
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include <vector>
+#include "ThreadPool.h"
+
+//Bits of each coordinate that go into a Morton key, so the box is split into 2^MORTON_BITS cells a side
+#define MORTON_BITS 12
+
+//Bits sorted by each pass of the radix sort
+#define RADIX_BITS 8
+
+//Sorts agents along a Z-order (Morton) curve over the simulation box, so agents that are close to each other in space end up close to each other in memory.
+//The keys are sorted with a least significant digit radix sort. Every pass counts the digits of fixed blocks of agents in parallel, scans the counts, and then every block scatters its agents in parallel, so the order is the same however many threads there are.
+class MortonOrder
+{
+	std::vector<unsigned int> keys;
+	std::vector<unsigned int> keysScratch;
+	std::vector<unsigned int> orderScratch;
+
+	//The count, and then the next free slot, of every digit in every block
+	std::vector<unsigned int> blockDigits;
+
+public:
+	//Fills order with the indices of the n agents inside the box [-boxSize, boxSize]^2 sorted by the Morton key of their position. The sort is stable, so agents in the same cell keep their order.
+	void sort(const double* x, const double* y, size_t n, double boxSize, ThreadPool& pool, std::vector<unsigned int>& order);
+};
@@ -0,0 +1,96 @@
+#include "NeighborList.h"
+
+using namespace std;
+
+NeighborList::NeighborList()
+{
+	maxMoveSquared = 0;
+}
+
+void NeighborList::build(const double* x, const double* y, size_t n, double reach, double skin, const SpatialGrid& grid, ThreadPool& pool)
+{
+	double cutoff = reach + skin;
+	maxMoveSquared = 0.25 * skin * skin;
+
+	builtX.assign(x, x + n);
+	builtY.assign(y, y + n);
+	start.resize(n + 1);
+
+	//The agents are split into fixed blocks. Every thread appends the lists of the blocks it does to a scratch array of its own, the block totals are scanned, and then every block copies its lists to its offset, so the lists come out in agent order whatever thread does which block.
+	size_t blockSize = pool.grainFor(n);
+	size_t blocks = (n + blockSize - 1) / blockSize;
+	blockTotal.resize(blocks + 1);
+	blockThread.resize(blocks);
+	blockScratch.resize(blocks);
+	threadScratch.resize(pool.size());
+	threadScratchUsed.assign(pool.size(), 0);
+
+	pool.parallelFor(blocks, 1, [&](size_t begin, size_t end, int thread) {
+		for (size_t block = begin;block < end;block++) {
+			size_t last = (block + 1) * blockSize < n ? (block + 1) * blockSize : n;
+			size_t used = threadScratchUsed[thread];
+			blockThread[block] = thread;
+			blockScratch[block] = used;
+			threadScratchUsed[thread] = listAgents(x, y, block * blockSize, last, cutoff, grid, threadScratch[thread], used);
+			blockTotal[block] = (unsigned int)(threadScratchUsed[thread] - used);
+		}
+	});
+
+	unsigned int total = 0;
+	for (size_t block = 0;block < blocks;block++) {
+		unsigned int blockCount = blockTotal[block];
+		blockTotal[block] = total;
+		total += blockCount;
+	}
+	start[n] = total;
+	neighbors.resize(total);
+
+	pool.parallelFor(blocks, 1, [&](size_t begin, size_t end, int thread) {
+		for (size_t block = begin;block < end;block++) {
+			size_t last = (block + 1) * blockSize < n ? (block + 1) * blockSize : n;
+			unsigned int offset = blockTotal[block];
+			const unsigned int* lists = threadScratch[blockThread[block]].data() + blockScratch[block];
+			unsigned int* out = neighbors.data() + offset;
+			size_t length = 0;
+			for (size_t i = block * blockSize;i < last;i++) {
+				unsigned int count = start[i];
+				start[i] = offset;
+				offset += count;
+				length += count;
+			}
+			for (size_t k = 0;k < length;k++) {
+				out[k] = lists[k];
+			}
+		}
+	});
+}
+
+//Appends the lists of the agents in [begin, end) to scratch after the first used entries, and puts their lengths in start. Returns how much of scratch is used now.
+size_t NeighborList::listAgents(const double* x, const double* y, size_t begin, size_t end, double cutoff, const SpatialGrid& grid, vector<unsigned int>& scratch, size_t used)
+{
+	double cutoffSquared = cutoff * cutoff;
+
+	for (size_t i = begin;i < end;i++) {
+		double positionX = x[i];
+		double positionY = y[i];
+
+		//Make room for every agent the query visits. Then every candidate can be stored, and only kept by moving on past it, instead of a branch that goes either way about half the time.
+		size_t candidates = grid.countInRange(positionX, positionY, cutoff);
+		if (scratch.size() < used + candidates) {
+			scratch.resize(2 * (used + candidates));
+		}
+		unsigned int* first = scratch.data() + used;
+		unsigned int* out = first;
+
+		grid.forEachInRange(positionX, positionY, cutoff, [&](size_t j) {
+			double distanceX = positionX - x[j];
+			double distanceY = positionY - y[j];
+			*out = (unsigned int)j;
+			out += (j != i) & (distanceX * distanceX + distanceY * distanceY < cutoffSquared);
+		});
+
+		start[i] = (unsigned int)(out - first);
+		used += out - first;
+	}
+	return used;
+}
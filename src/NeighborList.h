@@ -0,0 +1,56 @@
+#pragma once
+#include <vector>
+#include "SpatialGrid.h"
+#include "ThreadPool.h"
+
+//For every agent, the agents that were closer than reach + skin when the lists were built (Verlet lists).
+//As long as no agent has moved more than half the skin since then, no two agents can have come within reach of each other without being in each other's lists, so the lists can be reused for several steps instead of rebuilding the broad phase every step.
+//The lists are stored back to back (compressed rows): the neighbors of agent i are neighbors[start[i]] up to neighbors[start[i + 1]].
+class NeighborList
+{
+	std::vector<unsigned int> start;
+	std::vector<unsigned int> neighbors;
+	std::vector<unsigned int> blockTotal;
+
+	//Which thread listed each block, and where in that thread's scratch array
+	std::vector<int> blockThread;
+	std::vector<size_t> blockScratch;
+	std::vector<std::vector<unsigned int> > threadScratch;
+	std::vector<size_t> threadScratchUsed;
+
+	//Where every agent was when the lists were built
+	std::vector<double> builtX;
+	std::vector<double> builtY;
+	double maxMoveSquared;
+
+	size_t listAgents(const double* x, const double* y, size_t begin, size_t end, double cutoff, const SpatialGrid& grid, std::vector<unsigned int>& scratch, size_t used);
+
+public:
+	NeighborList();
+
+	//Lists the agents closer than reach + skin to each of the n agents. grid has to hold the same positions.
+	void build(const double* x, const double* y, size_t n, double reach, double skin, const SpatialGrid& grid, ThreadPool& pool);
+
+	//Whether an agent now at (x, y) has moved too far for the lists to be trusted any longer
+	bool movedTooFar(size_t agent, double x, double y) const
+	{
+		double moveX = x - builtX[agent];
+		double moveY = y - builtY[agent];
+		return moveX * moveX + moveY * moveY > maxMoveSquared;
+	}
+
+	//Calls visit(j) for every agent j in the list of agent, which doesn't include agent itself
+	template<class F>
+	void forEachNeighbor(size_t agent, const F& visit) const
+	{
+		for (unsigned int k = start[agent];k < start[agent + 1];k++) {
+			visit(neighbors[k]);
+		}
+	}
+
+	//The length of all the lists together
+	size_t size() const
+	{
+		return neighbors.size();
+	}
+};
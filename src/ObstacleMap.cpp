@@ -0,0 +1,101 @@
+#include "ObstacleMap.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+using namespace std;
+
+//Adds the obstacle described by one line of the file. Returns false if the line isn't an obstacle.
+static bool parseObstacle(char* line, vector<WallSegment>& segments)
+{
+	char* comment = strchr(line, '#');
+	if (comment != NULL) {
+		*comment = '\0';
+	}
+
+	char* cursor = line;
+	while (*cursor == ' ' || *cursor == '\t' || *cursor == '\r' || *cursor == '\n') {
+		cursor++;
+	}
+	if (*cursor == '\0') {
+		return true;
+	}
+
+	bool solid;
+	if (strncmp(cursor, "wall", 4) == 0) {
+		solid = false;
+		cursor += 4;
+	}
+	else if (strncmp(cursor, "polygon", 7) == 0) {
+		solid = true;
+		cursor += 7;
+	}
+	else {
+		return false;
+	}
+
+	vector<double> points;
+	while (true) {
+		char* end;
+		double value = strtod(cursor, &end);
+		if (end == cursor) {
+			break;
+		}
+		points.push_back(value);
+		cursor = end;
+	}
+	while (*cursor == ' ' || *cursor == '\t' || *cursor == '\r' || *cursor == '\n') {
+		cursor++;
+	}
+
+	size_t count = points.size() / 2;
+	if (*cursor != '\0' || points.size() % 2 != 0 || count < (solid ? 3u : 2u)) {
+		return false;
+	}
+
+	//A polygon's last edge goes back to its first point
+	size_t edges = solid ? count : count - 1;
+	for (size_t i = 0;i < edges;i++) {
+		size_t next = (i + 1) % count;
+		WallSegment segment;
+		segment.x1 = points[2 * i];
+		segment.y1 = points[2 * i + 1];
+		segment.x2 = points[2 * next];
+		segment.y2 = points[2 * next + 1];
+		segment.solid = solid;
+		segments.push_back(segment);
+	}
+	return true;
+}
+
+bool ObstacleMap::load(const char* file)
+{
+	segments.clear();
+
+	FILE* in = fopen(file, "r");
+	if (in == NULL) {
+		return false;
+	}
+
+	//Lines can be as long as the obstacle they describe, so they are put together from as many reads as it takes
+	vector<WallSegment> loaded;
+	string line;
+	char buffer[4096];
+	bool ok = true;
+	while (ok && fgets(buffer, sizeof(buffer), in) != NULL) {
+		line += buffer;
+		if (line[line.size() - 1] != '\n' && !feof(in)) {
+			continue;
+		}
+		ok = parseObstacle(&line[0], loaded);
+		line.clear();
+	}
+	fclose(in);
+
+	if (!ok) {
+		return false;
+	}
+	segments.swap(loaded);
+	return true;
+}
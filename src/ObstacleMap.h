@@ -0,0 +1,37 @@
+#pragma once
+#include <vector>
+
+//One straight piece of an obstacle's outline
+struct WallSegment
+{
+	double x1;
+	double y1;
+	double x2;
+	double y2;
+	//Whether the segment is an edge of a solid polygon, rather than a thin wall, so the side it is on counts as inside
+	bool solid;
+};
+
+//Static walls and solid obstacles (shelves, desks, pillars) inside the simulation box, loaded from a text file.
+//Every line of the file is one obstacle, in the coordinates of the box:
+//	wall x1 y1 x2 y2 [x3 y3 ...]	a thin wall through the points, open at both ends, so a doorway is the gap between two walls
+//	polygon x1 y1 x2 y2 x3 y3 [...]	a solid polygon, closed back to its first point, that agents stay outside of
+//Blank lines and everything after a # are ignored.
+class ObstacleMap
+{
+	std::vector<WallSegment> segments;
+
+public:
+	//Reads the obstacles from file. Returns false (and leaves the map empty) if it can't be read or a line doesn't make sense.
+	bool load(const char* file);
+
+	bool empty() const
+	{
+		return segments.empty();
+	}
+
+	const std::vector<WallSegment>& getSegments() const
+	{
+		return segments;
+	}
+};
@@ -0,0 +1,336 @@
+//Runs the simulation without a window and renders it offscreen into a numbered sequence of PNG images, e.g. for turning into a video on a server without a display.
+//The OpenGL context comes from EGL, so no display server is needed. Each frame is drawn by the same Renderer as the window, read back asynchronously through pixel buffers, and handed to a pool of threads that encode the PNG files while the simulation carries on.
+
+#define GL3W_IMPLEMENTATION 1
+#include "GL/gl3w.h"
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Simulation.h"
+#include "Profiler.h"
+#include "Renderer.h"
+#include "FrameWriter.h"
+
+using namespace std;
+
+//Compile-time replacements:
+#define FRAME_SIZE 1024
+#define MAX_QUEUED_FRAMES 16
+
+static void printUsage(const char* program)
+{
+	printf("usage: %s [options]\n", program);
+	printf("  --circles N        number of agents (default %d)\n", NUM_CIRCLES);
+	printf("  --steps N          number of simulation steps (default %d)\n", 10 * FRAMERATE);
+	printf("  --threads N        threads to step with, 0 for all hardware threads (default 0)\n");
+	printf("  --seed N           random seed (default: the current time)\n");
+	printf("  --radius R         circle radius (default %g)\n", CIRCLE_RADIUS);
+	printf("  --box B            half-width of the box the agents move in (default %g)\n", BOX_SIZE);
+	printf("  --airborne Q       quanta per second every infectious agent breathes out into the air, drawn over the agents (default %g)\n", AIRBORNE_EMISSION);
+	printf("  --size N           width and height of the frames in pixels (default %d)\n", FRAME_SIZE);
+	printf("  --mode MODE        mesh, sdf or density (default sdf)\n");
+	printf("  --every N          render every Nth step (default 1)\n");
+	printf("  --output PREFIX    frames are written to PREFIX000000.png, PREFIX000001.png, ... (default frame)\n");
+	printf("  --encoders N       threads encoding PNG files (default: one less than the hardware threads)\n");
+	printf("  --trace FILE       record a Chrome trace of the run into FILE\n");
+}
+
+//Makes an OpenGL 3.3 core context of the display current, without any surface. Everything is drawn into a framebuffer object.
+static bool makeContextCurrent(EGLDisplay display)
+{
+	if (display == EGL_NO_DISPLAY || !eglInitialize(display, NULL, NULL) || !eglBindAPI(EGL_OPENGL_API)) {
+		return false;
+	}
+
+	//Without a surface type, only configs that can draw to windows would match
+	const EGLint configAttributes[] = { EGL_SURFACE_TYPE, 0, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+	EGLConfig config;
+	EGLint numConfigs = 0;
+	if (!eglChooseConfig(display, configAttributes, &config, 1, &numConfigs) || numConfigs < 1) {
+		return false;
+	}
+
+	const EGLint contextAttributes[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 3,
+		EGL_CONTEXT_MINOR_VERSION, 3,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE
+	};
+	EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+	if (context == EGL_NO_CONTEXT) {
+		eglTerminate(display);
+		return false;
+	}
+	return eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context) == EGL_TRUE;
+}
+
+//Creates the context without a window or display server. Prefers a GPU found through EGL device enumeration, then Mesa's surfaceless platform, then the default display.
+static bool createContext()
+{
+	PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+	PFNEGLQUERYDEVICESEXTPROC queryDevices = (PFNEGLQUERYDEVICESEXTPROC)eglGetProcAddress("eglQueryDevicesEXT");
+
+	if (getPlatformDisplay != NULL && queryDevices != NULL) {
+		EGLDeviceEXT devices[16];
+		EGLint numDevices = 0;
+		if (queryDevices(16, devices, &numDevices)) {
+			for (int i = 0;i < numDevices;i++) {
+				if (makeContextCurrent(getPlatformDisplay(EGL_PLATFORM_DEVICE_EXT, devices[i], NULL))) {
+					return true;
+				}
+			}
+		}
+	}
+	if (getPlatformDisplay != NULL && makeContextCurrent(getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL))) {
+		return true;
+	}
+	return makeContextCurrent(eglGetDisplay(EGL_DEFAULT_DISPLAY));
+}
+
+//Copies the frame read back into pixelBuffer out to a frame of the writer, flipping it on the way since OpenGL's rows start at the bottom
+static void collectFrame(unsigned int pixelBuffer, int size, long long number, const char* prefix, FrameWriter& writer)
+{
+	TRACE_SCOPE("collect frame");
+
+	Frame* frame = writer.acquire();
+	frame->width = size;
+	frame->height = size;
+	frame->pixels.resize((size_t)size * size * 4);
+	char name[32];
+	snprintf(name, sizeof(name), "%06lld.png", number);
+	frame->path = string(prefix) + name;
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, pixelBuffer);
+	const unsigned char* pixels = (const unsigned char*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (size_t)size * size * 4, GL_MAP_READ_BIT);
+	if (pixels != NULL) {
+		size_t row = (size_t)size * 4;
+		for (int y = 0;y < size;y++) {
+			memcpy(frame->pixels.data() + y * row, pixels + (size - 1 - y) * row, row);
+		}
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	writer.submit(frame);
+}
+
+int main(int argc, char** argv)
+{
+	SimulationSettings settings;
+	int steps = 10 * FRAMERATE;
+	int size = FRAME_SIZE;
+	RenderMode mode = RENDER_SDF;
+	int every = 1;
+	const char* prefix = "frame";
+	int encoders = (int)thread::hardware_concurrency() - 1;
+	const char* traceFile = NULL;
+
+	for (int i = 1;i < argc;i++) {
+		if (strcmp(argv[i], "--circles") == 0 && i + 1 < argc) {
+			settings.numCircles = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--steps") == 0 && i + 1 < argc) {
+			steps = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+			settings.numThreads = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+			settings.seed = strtoull(argv[++i], NULL, 10);
+		}
+		else if (strcmp(argv[i], "--radius") == 0 && i + 1 < argc) {
+			settings.circleRadius = atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--box") == 0 && i + 1 < argc) {
+			settings.boxSize = atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--airborne") == 0 && i + 1 < argc) {
+			settings.airborneEmission = atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+			size = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--mode") == 0 && i + 1 < argc) {
+			i++;
+			if (strcmp(argv[i], "mesh") == 0) {
+				mode = RENDER_MESH;
+			}
+			else if (strcmp(argv[i], "sdf") == 0) {
+				mode = RENDER_SDF;
+			}
+			else if (strcmp(argv[i], "density") == 0) {
+				mode = RENDER_DENSITY;
+			}
+			else {
+				printUsage(argv[0]);
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "--every") == 0 && i + 1 < argc) {
+			every = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+			prefix = argv[++i];
+		}
+		else if (strcmp(argv[i], "--encoders") == 0 && i + 1 < argc) {
+			encoders = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+			traceFile = argv[++i];
+		}
+		else {
+			printUsage(argv[0]);
+			return strcmp(argv[i], "--help") == 0 ? 0 : 1;
+		}
+	}
+
+	if (settings.numCircles < 1 || steps < 0 || size < 1 || every < 1 || settings.circleRadius <= 0 || settings.boxSize <= settings.circleRadius) {
+		printUsage(argv[0]);
+		return 1;
+	}
+
+	if (!createContext()) {
+		fprintf(stderr, "Failed to create an EGL context\n");
+		return 1;
+	}
+	//gl3w looks the functions up through libGL, which with GLVND hands out the same functions to EGL contexts
+	if (gl3w_init() || !gl3w_is_supported(3, 3)) {
+		fprintf(stderr, "OpenGL 3.3 not supported\n");
+		return 1;
+	}
+	printf("OpenGL %s, GLSL %s\n", glGetString(GL_VERSION), glGetString(GL_SHADING_LANGUAGE_VERSION));
+
+	TraceRecorder::setThreadName("main");
+	if (traceFile != NULL) {
+		TraceRecorder::start();
+	}
+
+	Simulation simulation(settings);
+	simulation.createCircles();
+	size_t count = simulation.getPopulation().size();
+
+	Renderer renderer;
+	renderer.create();
+	InstanceStream instances;
+	instances.create(count);
+	vector<unsigned int> density;
+
+	//Everything is drawn into a square framebuffer of the frame size
+	unsigned int framebuffer;
+	unsigned int colorBuffer;
+	glGenFramebuffers(1, &framebuffer);
+	glGenRenderbuffers(1, &colorBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, size, size);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		fprintf(stderr, "Failed to create a %dx%d framebuffer\n", size, size);
+		return 1;
+	}
+	glViewport(0, 0, size, size);
+
+	//Frames are read back into one pixel buffer while the previous one is copied out of the other, so reading back never waits for the GPU to finish drawing
+	unsigned int pixelBuffers[2];
+	glGenBuffers(2, pixelBuffers);
+	for (int i = 0;i < 2;i++) {
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, pixelBuffers[i]);
+		glBufferData(GL_PIXEL_PACK_BUFFER, (size_t)size * size * 4, NULL, GL_STREAM_READ);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	FrameWriter writer(encoders, MAX_QUEUED_FRAMES);
+	long long frames = 0;
+	double stepSeconds = 0;
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	for (int step = 0;step <= steps;step++) {
+		//Step 0 is the starting positions
+		bool capture = step % every == 0;
+		int region = (int)(frames % INSTANCE_REGIONS);
+		CircleInstance* output = NULL;
+		if (capture && mode != RENDER_DENSITY) {
+			instances.waitForRegion(region);
+			output = instances.getRegion(region);
+		}
+
+		chrono::steady_clock::time_point stepStart = chrono::steady_clock::now();
+		if (step > 0) {
+			PROFILE_PHASE(PHASE_STEP);
+			simulation.setInstanceOutput(output);
+			simulation.circleMotion();
+			simulation.setInstanceOutput(NULL);
+		}
+		else if (output != NULL) {
+			simulation.writeInstances(output);
+		}
+		stepSeconds += chrono::duration<double>(chrono::steady_clock::now() - stepStart).count();
+
+		if (!capture) {
+			continue;
+		}
+
+		{
+			TRACE_SCOPE("draw");
+			glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+			glClear(GL_COLOR_BUFFER_BIT);
+			if (mode == RENDER_DENSITY) {
+				unsigned int peak = simulation.densityHistogram(DENSITY_RESOLUTION, density);
+				renderer.uploadDensity(density, peak);
+				renderer.drawDensity();
+			}
+			else {
+				instances.upload(region, count);
+				renderer.drawCircles(mode, instances, region, count, settings.boxSize);
+			}
+			if (settings.airborneEmission > 0) {
+				const AirborneField& airborne = simulation.getAirborne();
+				renderer.uploadAirborne(airborne.getConcentration(), airborne.getResolution(), airborne.getPeak());
+				renderer.drawAirborne();
+			}
+
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, pixelBuffers[frames % 2]);
+			glReadPixels(0, 0, size, size, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		}
+
+		//The previous frame has had a whole step to finish reading back
+		if (frames > 0) {
+			collectFrame(pixelBuffers[(frames - 1) % 2], size, frames - 1, prefix, writer);
+		}
+		frames++;
+	}
+	if (frames > 0) {
+		collectFrame(pixelBuffers[(frames - 1) % 2], size, frames - 1, prefix, writer);
+	}
+	double renderSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	int failures = writer.finish();
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	if (traceFile != NULL && !TraceRecorder::stop(traceFile)) {
+		fprintf(stderr, "Failed to write %s\n", traceFile);
+	}
+
+	printf("%d agents, %d steps, %lld frames of %dx%d\n", settings.numCircles, steps, frames, size, size);
+	printf("stepping %.3f s, stepping and rendering %.3f s, until every frame was written %.3f s\n", stepSeconds, renderSeconds, seconds);
+	if (failures > 0) {
+		fprintf(stderr, "Failed to write %d frames\n", failures);
+	}
+
+	glDeleteBuffers(2, pixelBuffers);
+	glDeleteRenderbuffers(1, &colorBuffer);
+	glDeleteFramebuffers(1, &framebuffer);
+	instances.destroy();
+	renderer.destroy();
+
+	return failures > 0 ? 1 : 0;
+}
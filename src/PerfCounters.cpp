@@ -0,0 +1,164 @@
+#include "PerfCounters.h"
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+struct ThreadCounters
+{
+	const void* owner;
+	int fd[NUM_PERF_COUNTERS];
+};
+
+static mutex threadsLock;
+static vector<ThreadCounters> threads;
+
+//Closes the counters of its thread when the thread exits, so a thread pool that gets rebuilt doesn't leave its old threads' counters open and counted
+struct ThreadAttachment
+{
+	bool attached;
+
+	ThreadAttachment()
+	{
+		attached = false;
+	}
+
+	~ThreadAttachment()
+	{
+		if (!attached) {
+			return;
+		}
+
+		lock_guard<mutex> guard(threadsLock);
+		for (size_t t = 0;t < threads.size();t++) {
+			if (threads[t].owner != this) {
+				continue;
+			}
+#ifdef __linux__
+			for (int i = 0;i < NUM_PERF_COUNTERS;i++) {
+				if (threads[t].fd[i] >= 0) {
+					close(threads[t].fd[i]);
+				}
+			}
+#endif
+			threads.erase(threads.begin() + t);
+			break;
+		}
+	}
+};
+
+static thread_local ThreadAttachment attachment;
+
+#ifdef __linux__
+static int openCounter(unsigned int type, unsigned long long config)
+{
+	perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = type;
+	attr.config = config;
+
+	//User space only, so this still works with the default perf_event_paranoid setting of 2
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+
+	//The enabled and running times let read() correct for the kernel time-sharing the hardware counters
+	attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+	//pid 0 and cpu -1 count the calling thread on whichever CPU it runs
+	return (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+#endif
+
+void PerfCounters::attachThread()
+{
+	if (attachment.attached) {
+		return;
+	}
+	attachment.attached = true;
+
+	ThreadCounters counters;
+	counters.owner = &attachment;
+	for (int i = 0;i < NUM_PERF_COUNTERS;i++) {
+		counters.fd[i] = -1;
+	}
+
+#ifdef __linux__
+	counters.fd[COUNTER_CYCLES] = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+	counters.fd[COUNTER_INSTRUCTIONS] = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+	counters.fd[COUNTER_LLC_MISSES] = openCounter(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+	//Not every CPU exposes the last level cache as a generic cache event, but the generic cache miss event usually means the same thing
+	if (counters.fd[COUNTER_LLC_MISSES] < 0) {
+		counters.fd[COUNTER_LLC_MISSES] = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+	}
+	counters.fd[COUNTER_BRANCH_MISSES] = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+#endif
+
+	lock_guard<mutex> guard(threadsLock);
+	threads.push_back(counters);
+}
+
+bool PerfCounters::available(PerfCounter counter)
+{
+	lock_guard<mutex> guard(threadsLock);
+	for (size_t i = 0;i < threads.size();i++) {
+		if (threads[i].fd[counter] >= 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void PerfCounters::read(PerfCounterValues& values)
+{
+	for (int i = 0;i < NUM_PERF_COUNTERS;i++) {
+		values.value[i] = 0;
+	}
+
+#ifdef __linux__
+	lock_guard<mutex> guard(threadsLock);
+	for (size_t t = 0;t < threads.size();t++) {
+		for (int i = 0;i < NUM_PERF_COUNTERS;i++) {
+			if (threads[t].fd[i] < 0) {
+				continue;
+			}
+
+			//Value, time enabled, time running
+			unsigned long long data[3];
+			if (::read(threads[t].fd[i], data, sizeof(data)) != (ssize_t)sizeof(data) || data[2] == 0) {
+				continue;
+			}
+
+			if (data[2] < data[1]) {
+				values.value[i] += (unsigned long long)((double)data[0] * data[1] / data[2]);
+			}
+			else {
+				values.value[i] += data[0];
+			}
+		}
+	}
+#endif
+}
+
+const char* PerfCounters::name(PerfCounter counter)
+{
+	switch (counter) {
+	case COUNTER_CYCLES:
+		return "cycles";
+	case COUNTER_INSTRUCTIONS:
+		return "instructions";
+	case COUNTER_LLC_MISSES:
+		return "LLC misses";
+	case COUNTER_BRANCH_MISSES:
+		return "branch misses";
+	default:
+		return "unknown";
+	}
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+//The hardware events that get sampled around each step phase
+enum PerfCounter
+{
+	COUNTER_CYCLES,
+	COUNTER_INSTRUCTIONS,
+	COUNTER_LLC_MISSES,
+	COUNTER_BRANCH_MISSES,
+	NUM_PERF_COUNTERS
+};
+
+struct PerfCounterValues
+{
+	unsigned long long value[NUM_PERF_COUNTERS];
+};
+
+//Hardware performance counters read through Linux perf_event_open.
+//Every thread that does simulation work attaches its own set of counters, and read() sums them across all attached threads, so a phase that is split over several threads is still counted completely.
+//On other platforms, or when the kernel refuses access (see /proc/sys/kernel/perf_event_paranoid), the counters report as unavailable and read() returns zeros.
+class PerfCounters
+{
+public:
+	//Opens the counters for the calling thread, which are closed again when the thread exits. Calling it again from the same thread does nothing.
+	static void attachThread();
+
+	//True if the counter could be opened on at least one attached thread
+	static bool available(PerfCounter counter);
+
+	//Sums the current value of every counter over all attached threads, scaled up if the kernel had to multiplex them
+	static void read(PerfCounterValues& values);
+
+	static const char* name(PerfCounter counter);
+};
@@ -0,0 +1,221 @@
+#include "PoissonPlacement.h"
+#include "Random.h"
+#include <cmath>
+
+using namespace std;
+
+PoissonPlacement::PoissonPlacement()
+{
+	cellsPerSide = 1;
+	cellSize = 2.0;
+	walls = NULL;
+}
+
+void PoissonPlacement::layout(size_t n, double boxSize, double maxRadius)
+{
+	double extent = 2.0 * boxSize;
+
+	//As many cells as fit, but no more than one for every four agents, as every cell costs a few counters
+	double fit = floor(extent / (2.0 * maxRadius));
+	double limit = floor(sqrt(n / 4.0));
+	if (limit < PLACEMENT_MIN_CELLS) {
+		limit = PLACEMENT_MIN_CELLS;
+	}
+	cellsPerSide = (int)(fit < limit ? fit : limit);
+	if (cellsPerSide < 1) {
+		cellsPerSide = 1;
+	}
+	cellSize = extent / cellsPerSide;
+
+	size_t cells = (size_t)cellsPerSide * cellsPerSide;
+	weight.resize(cells);
+	slotStart.resize(cells + 1);
+	target.assign(cells, 0);
+	filled.assign(cells, 0);
+	full.assign(cells, 0);
+}
+
+//Hands amount more agents to the cells that aren't full, in proportion to their weight, so that they add up exactly. Once the slots have been laid out, no cell gets more than it has slots for. Returns how many were handed out.
+size_t PoissonPlacement::share(size_t amount, bool limited)
+{
+	size_t cells = target.size();
+	size_t handed = 0;
+
+	//What the cells without room left over goes round again to the ones that still have some, until they are all handed out or no cell has room left
+	while (handed < amount) {
+		double total = 0;
+		for (size_t c = 0;c < cells;c++) {
+			if (!full[c] && (!limited || slotStart[c + 1] - slotStart[c] > target[c])) {
+				total += weight[c];
+			}
+		}
+		if (!(total > 0)) {
+			break;
+		}
+
+		size_t remaining = amount - handed;
+		size_t given = 0;
+		double sum = 0;
+		size_t before = 0;
+		for (size_t c = 0;c < cells;c++) {
+			size_t room = slotStart[c + 1] - slotStart[c] - target[c];
+			if (full[c] || (limited && room == 0)) {
+				continue;
+			}
+			sum += weight[c];
+			size_t upTo = (size_t)floor(remaining * (sum / total));
+			if (upTo > remaining) {
+				upTo = remaining;
+			}
+			size_t extra = upTo - before;
+			before = upTo;
+			if (limited) {
+				extra = extra < room ? extra : room;
+			}
+			target[c] += (unsigned int)extra;
+			given += extra;
+		}
+		if (given == 0) {
+			break;
+		}
+		handed += given;
+	}
+	return handed;
+}
+
+//Throws darts for the agents the cell still has to place, until one of them doesn't fit
+void PoissonPlacement::fillCell(int column, int row, double boxSize, double minRadius, double radiusRatio, unsigned long long seed)
+{
+	size_t c = (size_t)row * cellsPerSide + column;
+	if (full[c]) {
+		return;
+	}
+
+	double maxRadius = radiusRatio > 1 ? minRadius * radiusRatio : minRadius;
+	double left = -boxSize + column * cellSize;
+	double bottom = -boxSize + row * cellSize;
+	int firstX = column > 0 ? column - 1 : 0;
+	int lastX = column < cellsPerSide - 1 ? column + 1 : cellsPerSide - 1;
+	int firstY = row > 0 ? row - 1 : 0;
+	int lastY = row < cellsPerSide - 1 ? row + 1 : cellsPerSide - 1;
+
+	for (unsigned int k = filled[c];k < target[c];k++) {
+		//The same distribution as createCircles() draws the radii from
+		double radius = minRadius;
+		if (radiusRatio > 1) {
+			double u = randomUniform(seed, RANDOM_PLACEMENT, 6, c, k);
+			radius = minRadius / sqrt(1 - u * (1 - 1 / (radiusRatio * radiusRatio)));
+			radius = radius < maxRadius ? radius : maxRadius;
+		}
+
+		//The part of the cell the circle fits in without sticking out of the box
+		double lowX = left > -boxSize + radius ? left : -boxSize + radius;
+		double highX = left + cellSize < boxSize - radius ? left + cellSize : boxSize - radius;
+		double lowY = bottom > -boxSize + radius ? bottom : -boxSize + radius;
+		double highY = bottom + cellSize < boxSize - radius ? bottom + cellSize : boxSize - radius;
+
+		bool placed = false;
+		for (int attempt = 0;attempt < PLACEMENT_ATTEMPTS && !placed;attempt++) {
+			unsigned long long dart = (unsigned long long)k * PLACEMENT_ATTEMPTS + attempt;
+			double positionX = lowX + randomUniform(seed, RANDOM_PLACEMENT, 7, c, dart) * (highX - lowX);
+			double positionY = lowY + randomUniform(seed, RANDOM_PLACEMENT, 8, c, dart) * (highY - lowY);
+
+			placed = walls == NULL || walls->distance(positionX, positionY) >= radius;
+			for (int otherRow = firstY;otherRow <= lastY && placed;otherRow++) {
+				for (int otherColumn = firstX;otherColumn <= lastX && placed;otherColumn++) {
+					size_t other = (size_t)otherRow * cellsPerSide + otherColumn;
+					for (unsigned int s = slotStart[other];s < slotStart[other] + filled[other];s++) {
+						double distanceX = positionX - slotX[s];
+						double distanceY = positionY - slotY[s];
+						double reach = radius + slotRadius[s];
+						if (distanceX * distanceX + distanceY * distanceY < reach * reach) {
+							placed = false;
+							break;
+						}
+					}
+				}
+			}
+
+			if (placed) {
+				unsigned int slot = slotStart[c] + k;
+				slotX[slot] = positionX;
+				slotY[slot] = positionY;
+				slotRadius[slot] = radius;
+				filled[c] = k + 1;
+			}
+		}
+
+		if (!placed) {
+			full[c] = 1;
+			return;
+		}
+	}
+}
+
+size_t PoissonPlacement::fill(size_t n, double* x, double* y, double* radius, double boxSize, double minRadius, double radiusRatio, unsigned long long seed, ThreadPool& pool)
+{
+	size_t cells = (size_t)cellsPerSide * cellsPerSide;
+	share(n, false);
+
+	//Every cell gets a quarter more slots than its share (and any cell the density reaches at least one), for the agents other cells can't fit
+	unsigned int total = 0;
+	for (size_t c = 0;c < cells;c++) {
+		slotStart[c] = total;
+		total += target[c] + target[c] / 4 + (weight[c] > 0 ? 1 : 0);
+	}
+	slotStart[cells] = total;
+	slotX.resize(total);
+	slotY.resize(total);
+	slotRadius.resize(total);
+
+	size_t placed = 0;
+	for (int round = 0;round < PLACEMENT_ROUNDS;round++) {
+		for (int pass = 0;pass < 4;pass++) {
+			int firstColumn = pass & 1;
+			int firstRow = pass >> 1;
+			size_t rows = (cellsPerSide - firstRow + 1) / 2;
+			pool.parallelFor(rows, 1, [&](size_t begin, size_t end, int thread) {
+				for (size_t r = begin;r < end;r++) {
+					for (int column = firstColumn;column < cellsPerSide;column += 2) {
+						fillCell(column, firstRow + 2 * (int)r, boxSize, minRadius, radiusRatio, seed);
+					}
+				}
+			});
+		}
+
+		placed = 0;
+		for (size_t c = 0;c < cells;c++) {
+			placed += filled[c];
+		}
+		if (placed == n || share(n - placed, true) == 0) {
+			break;
+		}
+	}
+
+	//The cells the rounds handed the last few agents to are mostly the ones that were already full, so whatever is still left is offered to every cell with room in turn, one agent at a time, until they are all placed or every cell is full
+	for (size_t c = 0;c < cells && placed < n;c++) {
+		target[c] = filled[c];
+		while (placed < n && !full[c] && slotStart[c + 1] - slotStart[c] > filled[c]) {
+			target[c]++;
+			fillCell((int)(c % cellsPerSide), (int)(c / cellsPerSide), boxSize, minRadius, radiusRatio, seed);
+			placed += full[c] ? 0 : 1;
+		}
+	}
+
+	//Pack the cells one after the other, which leaves the agents roughly sorted by where they are
+	unsigned int offset = 0;
+	for (size_t c = 0;c < cells;c++) {
+		target[c] = offset;
+		offset += filled[c];
+	}
+	pool.parallelFor(cells, pool.grainFor(cells, 4096), [&](size_t begin, size_t end, int thread) {
+		for (size_t c = begin;c < end;c++) {
+			for (unsigned int k = 0;k < filled[c];k++) {
+				x[target[c] + k] = slotX[slotStart[c] + k];
+				y[target[c] + k] = slotY[slotStart[c] + k];
+				radius[target[c] + k] = slotRadius[slotStart[c] + k];
+			}
+		}
+	});
+	return placed;
+}
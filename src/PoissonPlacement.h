@@ -0,0 +1,70 @@
+#pragma once
+#include <vector>
+#include "DistanceField.h"
+#include "ThreadPool.h"
+
+//Darts thrown for each agent before its cell counts as full
+#define PLACEMENT_ATTEMPTS 32
+
+//Rounds of handing the agents that didn't fit to the cells that still have room
+#define PLACEMENT_ROUNDS 8
+
+//The fewest cells the box is split into, so even a small population follows the density closely enough
+#define PLACEMENT_MIN_CELLS 64
+
+//Places circles in the box so that none of them overlap (Poisson-disk sampling by dart throwing), in parallel.
+//The box is split into cells at least as wide as the biggest circle, so a circle can only overlap the circles of its own and the eight cells around it. Every cell is given its share of the agents by the density, and throws darts for each of them in turn, keeping those that don't overlap anything.
+//The cells are done in four passes, one for every combination of even and odd column and row, so the cells of a pass are at least a cell apart and can be filled by different threads without locks.
+//Every dart is keyed by the cell and the agent's slot in it, so the result is the same however many threads there are.
+class PoissonPlacement
+{
+	int cellsPerSide;
+	double cellSize;
+	const DistanceField* walls;
+
+	std::vector<double> weight;
+	std::vector<unsigned int> slotStart;
+	std::vector<unsigned int> target;
+	std::vector<unsigned int> filled;
+	std::vector<unsigned char> full;
+
+	//The circles placed in every cell, in slots from slotStart
+	std::vector<double> slotX;
+	std::vector<double> slotY;
+	std::vector<double> slotRadius;
+
+	void layout(size_t n, double boxSize, double maxRadius);
+	size_t share(size_t amount, bool limited);
+	void fillCell(int column, int row, double boxSize, double minRadius, double radiusRatio, unsigned long long seed);
+	size_t fill(size_t n, double* x, double* y, double* radius, double boxSize, double minRadius, double radiusRatio, unsigned long long seed, ThreadPool& pool);
+
+public:
+	PoissonPlacement();
+
+	//Keeps the circles from overlapping the walls of the field too, or not with NULL
+	void setWalls(const DistanceField* walls)
+	{
+		this->walls = walls;
+	}
+
+	//Places up to n circles inside the box [-boxSize, boxSize]^2 without overlaps, with radii from minRadius to radiusRatio times that (drawn like createCircles() does), spread out over the box in proportion to density(x, y).
+	//Writes them to the start of x, y and radius in cell order, and returns how many fit. If the density asks for more than fits, some cells fill up and the rest are handed to the others, but a box that is too full can still leave some out.
+	template<class F>
+	size_t place(size_t n, double boxSize, double minRadius, double radiusRatio, unsigned long long seed, ThreadPool& pool, const F& density, double* x, double* y, double* radius)
+	{
+		double maxRadius = radiusRatio > 1 ? minRadius * radiusRatio : minRadius;
+		layout(n, boxSize, maxRadius);
+
+		size_t cells = (size_t)cellsPerSide * cellsPerSide;
+		pool.parallelFor(cells, pool.grainFor(cells, 4096), [&](size_t begin, size_t end, int thread) {
+			for (size_t c = begin;c < end;c++) {
+				double centerX = -boxSize + ((c % cellsPerSide) + 0.5) * cellSize;
+				double centerY = -boxSize + ((c / cellsPerSide) + 0.5) * cellSize;
+				double value = density(centerX, centerY);
+				weight[c] = value > 0 ? value : 0;
+			}
+		});
+
+		return fill(n, x, y, radius, boxSize, minRadius, radiusRatio, seed, pool);
+	}
+};
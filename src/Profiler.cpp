@@ -0,0 +1,114 @@
+#include "Profiler.h"
+
+bool Profiler::countersEnabled = false;
+PhaseStats Profiler::stats[NUM_PHASES];
+
+void Profiler::enableCounters(bool enable)
+{
+	if (enable) {
+		PerfCounters::attachThread();
+	}
+	countersEnabled = enable;
+}
+
+void Profiler::reset()
+{
+	for (int phase = 0;phase < NUM_PHASES;phase++) {
+		stats[phase].calls = 0;
+		stats[phase].seconds = 0.0;
+		for (int i = 0;i < NUM_PERF_COUNTERS;i++) {
+			stats[phase].counters[i] = 0;
+		}
+	}
+}
+
+const char* Profiler::name(StepPhase phase)
+{
+	switch (phase) {
+	case PHASE_STEP:
+		return "step";
+	case PHASE_BROADPHASE:
+		return "broad-phase";
+	case PHASE_COLLISION:
+		return "collision";
+	case PHASE_INFECTION:
+		return "infection";
+	case PHASE_AIRBORNE:
+		return "airborne";
+	case PHASE_REORDER:
+		return "reorder";
+	default:
+		return "unknown";
+	}
+}
+
+void Profiler::add(StepPhase phase, double seconds, const PerfCounterValues* begin, const PerfCounterValues* end)
+{
+	stats[phase].calls++;
+	stats[phase].seconds += seconds;
+	if (begin != NULL && end != NULL) {
+		for (int i = 0;i < NUM_PERF_COUNTERS;i++) {
+			stats[phase].counters[i] += end->value[i] - begin->value[i];
+		}
+	}
+}
+
+void Profiler::printReport(FILE* file, double agentSteps)
+{
+	if (agentSteps < 1.0) {
+		agentSteps = 1.0;
+	}
+
+	fprintf(file, "%-12s %10s %12s %14s", "phase", "calls", "total ms", "ns/agent-step");
+	if (countersEnabled) {
+		for (int i = 0;i < NUM_PERF_COUNTERS;i++) {
+			fprintf(file, " %16s", PerfCounters::name((PerfCounter)i));
+		}
+		fprintf(file, " %8s", "IPC");
+	}
+	fprintf(file, "\n");
+
+	for (int phase = 0;phase < NUM_PHASES;phase++) {
+		const PhaseStats& s = stats[phase];
+		fprintf(file, "%-12s %10llu %12.3f %14.3f", name((StepPhase)phase), s.calls, s.seconds * 1000.0, s.seconds * 1e9 / agentSteps);
+		if (countersEnabled) {
+			for (int i = 0;i < NUM_PERF_COUNTERS;i++) {
+				if (PerfCounters::available((PerfCounter)i)) {
+					fprintf(file, " %16llu", s.counters[i]);
+				}
+				else {
+					fprintf(file, " %16s", "n/a");
+				}
+			}
+			if (PerfCounters::available(COUNTER_INSTRUCTIONS) && s.counters[COUNTER_CYCLES] > 0) {
+				fprintf(file, " %8.3f", (double)s.counters[COUNTER_INSTRUCTIONS] / s.counters[COUNTER_CYCLES]);
+			}
+			else {
+				fprintf(file, " %8s", "n/a");
+			}
+		}
+		fprintf(file, "\n");
+	}
+
+	//The same counters again, normalized so runs with different population sizes and step counts can be compared
+	if (countersEnabled) {
+		fprintf(file, "\nper agent-step:\n");
+		fprintf(file, "%-12s", "phase");
+		for (int i = 0;i < NUM_PERF_COUNTERS;i++) {
+			fprintf(file, " %16s", PerfCounters::name((PerfCounter)i));
+		}
+		fprintf(file, "\n");
+		for (int phase = 0;phase < NUM_PHASES;phase++) {
+			fprintf(file, "%-12s", name((StepPhase)phase));
+			for (int i = 0;i < NUM_PERF_COUNTERS;i++) {
+				if (PerfCounters::available((PerfCounter)i)) {
+					fprintf(file, " %16.4f", stats[phase].counters[i] / agentSteps);
+				}
+				else {
+					fprintf(file, " %16s", "n/a");
+				}
+			}
+			fprintf(file, "\n");
+		}
+	}
+}
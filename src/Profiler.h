@@ -0,0 +1,84 @@
+#pragma once
+#include <chrono>
+#include <cstdio>
+#include "PerfCounters.h"
+#include "Trace.h"
+
+//The phases of a simulation step that get timed. Each one also shows up as a named event in a recorded trace.
+enum StepPhase
+{
+	PHASE_STEP,
+	PHASE_BROADPHASE,
+	PHASE_COLLISION,
+	PHASE_INFECTION,
+	PHASE_AIRBORNE,
+	PHASE_REORDER,
+	NUM_PHASES
+};
+
+struct PhaseStats
+{
+	unsigned long long calls;
+	double seconds;
+	unsigned long long counters[NUM_PERF_COUNTERS];
+};
+
+//Accumulates wall time, and optionally hardware counters, for each step phase.
+//Phases are timed from the thread that drives the step. Worker threads only need to call PerfCounters::attachThread() so their share of the work is counted.
+class Profiler
+{
+	static bool countersEnabled;
+	static PhaseStats stats[NUM_PHASES];
+
+public:
+	//Reading the counters costs a few system calls per attached thread, so it only happens once this has been turned on
+	static void enableCounters(bool enable);
+	static bool counters()
+	{
+		return countersEnabled;
+	}
+
+	static void reset();
+	static const PhaseStats& phase(StepPhase phase)
+	{
+		return stats[phase];
+	}
+	static const char* name(StepPhase phase);
+
+	static void add(StepPhase phase, double seconds, const PerfCounterValues* begin, const PerfCounterValues* end);
+
+	//Prints a table with the time and counters of every phase, both in total and divided by the number of agent-steps (agents times steps) simulated
+	static void printReport(FILE* file, double agentSteps);
+};
+
+class PhaseScope
+{
+	StepPhase phase;
+	TraceScope trace;
+	std::chrono::steady_clock::time_point start;
+	PerfCounterValues startCounters;
+
+public:
+	PhaseScope(StepPhase phase) : phase(phase), trace(Profiler::name(phase))
+	{
+		if (Profiler::counters()) {
+			PerfCounters::read(startCounters);
+		}
+		start = std::chrono::steady_clock::now();
+	}
+
+	~PhaseScope()
+	{
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		if (Profiler::counters()) {
+			PerfCounterValues endCounters;
+			PerfCounters::read(endCounters);
+			Profiler::add(phase, seconds, &startCounters, &endCounters);
+		}
+		else {
+			Profiler::add(phase, seconds, NULL, NULL);
+		}
+	}
+};
+
+#define PROFILE_PHASE(phase) PhaseScope TRACE_CONCAT(phaseScope, __LINE__)(phase)
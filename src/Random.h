@@ -0,0 +1,38 @@
+#pragma once
+
+//Counter-based random numbers. Instead of drawing from a shared generator like rand(), every random decision is a hash of the seed and of what is being decided (which step, which agents).
+//That way threads never share generator state, and a run gives the same result no matter how many threads it is split over.
+
+//Which kind of decision a random number is for, so that e.g. placement and infection never reuse the same numbers
+enum RandomStream
+{
+	RANDOM_PLACEMENT,
+	RANDOM_INFECTION,
+	RANDOM_RECOVERY,
+	//Which stage an infected agent moves on to
+	RANDOM_PROGRESSION,
+	//How much exposure a pair of agents takes to pass it on
+	RANDOM_EXPOSURE,
+	//Whether an agent catches it from the air
+	RANDOM_AIRBORNE
+};
+
+//The splitmix64 finalizer: a cheap bijection that spreads every input bit over the whole output
+inline unsigned long long mixBits(unsigned long long z)
+{
+	z += 0x9e3779b97f4a7c15ULL;
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	return z ^ (z >> 31);
+}
+
+inline unsigned long long randomBits(unsigned long long seed, RandomStream stream, unsigned long long step, unsigned long long a, unsigned long long b = 0)
+{
+	return mixBits(mixBits(mixBits(mixBits(seed ^ (unsigned long long)stream) ^ step) ^ a) ^ b);
+}
+
+//Uniform in [0, 1)
+inline double randomUniform(unsigned long long seed, RandomStream stream, unsigned long long step, unsigned long long a, unsigned long long b = 0)
+{
+	return (randomBits(seed, stream, step, a, b) >> 11) * (1.0 / 9007199254740992.0);
+}
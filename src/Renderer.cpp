@@ -0,0 +1,452 @@
+#include "Renderer.h"
+
+#include <cstddef>
+#include <iostream>
+#include <math.h>
+#include <vector>
+
+using namespace std;
+
+//Source code for the vertex shader. This program is written for OpenGL and describes how to transform the vertex data to put it on the screen
+const char *vertexShaderSource = "#version 330 core\n"
+"layout (location=0) in vec3 position;\n" //Specifies that the position vector should be put in location 0
+
+//The center and radius of the circle being drawn, and its state. These come from the instance buffer, one per circle.
+"layout (location=1) in vec3 instance;\n"
+"layout (location=2) in uint state;\n"
+
+//This scales the box the circles move in to fill the viewport
+"uniform float scale;\n"
+
+//This will hold the rgb color data of each state, one per AgentState
+"uniform vec3 colors[6];\n"
+
+"out VS_OUT {\n"
+"	vec4 color;\n"
+"} vs_out;\n"
+
+
+"void main()\n"
+"{\n"
+"	gl_Position=vec4((instance.xy+position.xy*instance.z)*scale,0.0,1.0);\n"
+"	vs_out.color=vec4(colors[state], 1.0);\n"
+"}\0";
+
+//Source code for the fragment shader. This program is also written for OpenGL and describes how to color shapes that we are passing in. It colors everything the same color.
+const char *fragmentShaderSource = "#version 330 core\n"
+    "out vec4 FragColor;\n"
+	"in VS_OUT{\n"
+	"	vec4 color;\n"
+	"} fs_in;\n"
+    "void main()\n"
+    "{\n"
+    "   FragColor = fs_in.color;\n"
+	"}\0";
+
+
+//Source code for the vertex shader of the signed distance rendering. It makes a quad around each circle out of nothing but the vertex number, so there is no mesh to read.
+const char *sdfVertexShaderSource = "#version 330 core\n"
+"layout (location=1) in vec3 instance;\n"
+"layout (location=2) in uint state;\n"
+"uniform float scale;\n"
+"uniform vec3 colors[6];\n"
+
+//The size of a pixel in the same units as gl_Position, so even circles smaller than a pixel still cover one
+"uniform float pixelSize;\n"
+
+"out VS_OUT {\n"
+"	vec4 color;\n"
+"	vec2 local;\n"
+"} vs_out;\n"
+
+"void main()\n"
+"{\n"
+"	vec2 corner=vec2(float(gl_VertexID&1),float((gl_VertexID>>1)&1))*2.0-1.0;\n"
+"	float radius=instance.z*scale;\n"
+"	float extent=radius+pixelSize;\n"
+"	gl_Position=vec4(instance.xy*scale+corner*extent,0.0,1.0);\n"
+
+//Where the corner is relative to the circle, measured in radii
+"	vs_out.local=corner*extent/radius;\n"
+"	vs_out.color=vec4(colors[state], 1.0);\n"
+"}\0";
+
+//Source code for the fragment shader of the signed distance rendering. The distance to the edge of the circle, divided by how much it changes over a pixel, gives how much of the pixel the circle covers.
+const char *sdfFragmentShaderSource = "#version 330 core\n"
+	"out vec4 FragColor;\n"
+	"in VS_OUT{\n"
+	"	vec4 color;\n"
+	"	vec2 local;\n"
+	"} fs_in;\n"
+	"void main()\n"
+	"{\n"
+	"	float distance=length(fs_in.local)-1.0;\n"
+	"	float coverage=clamp(0.5-distance/fwidth(distance),0.0,1.0);\n"
+	"	if (coverage<=0.0) discard;\n"
+	"	FragColor=vec4(fs_in.color.rgb,coverage);\n"
+	"}\0";
+
+//Source code for the vertex shader of the density rendering. It covers the whole viewport with one quad, again made out of the vertex number.
+const char *densityVertexShaderSource = "#version 330 core\n"
+"out vec2 cell;\n"
+"void main()\n"
+"{\n"
+"	vec2 corner=vec2(float(gl_VertexID&1),float((gl_VertexID>>1)&1));\n"
+"	cell=corner;\n"
+"	gl_Position=vec4(corner*2.0-1.0,0.0,1.0);\n"
+"}\0";
+
+//Source code for the fragment shader of the density rendering. The color is the average of the state colors, weighted by how many circles of each state are in the cell, and the brightness grows with the logarithm of the number of circles.
+const char *densityFragmentShaderSource = "#version 330 core\n"
+	"out vec4 FragColor;\n"
+	"in vec2 cell;\n"
+	"uniform usampler2D density;\n"
+	"uniform vec3 colors[6];\n"
+
+	//The logarithm of the most circles in a cell, which gets full brightness
+	"uniform float peak;\n"
+
+	"void main()\n"
+	"{\n"
+	//Every cell is two texels wide, the first holding the counts of the first three states and the second the counts of the other three
+	"	ivec2 size=textureSize(density,0);\n"
+	"	ivec2 texel=min(ivec2(cell*vec2(size.x/2,size.y)),ivec2(size.x/2-1,size.y-1))*ivec2(2,1);\n"
+	"	vec3 counts=vec3(texelFetch(density,texel,0).rgb);\n"
+	"	vec3 more=vec3(texelFetch(density,texel+ivec2(1,0),0).rgb);\n"
+	"	float total=counts.r+counts.g+counts.b+more.r+more.g+more.b;\n"
+	"	if (total==0.0) discard;\n"
+	"	vec3 color=(counts.r*colors[0]+counts.g*colors[1]+counts.b*colors[2]+more.r*colors[3]+more.g*colors[4]+more.b*colors[5])/total;\n"
+	"	FragColor=vec4(color*log(1.0+total)/peak,1.0);\n"
+	"}\0";
+
+//Source code for the fragment shader of the airborne overlay, drawn with the quad of the density rendering. The more quanta in the air, the less transparent the haze, relative to the highest concentration anywhere.
+const char *airborneFragmentShaderSource = "#version 330 core\n"
+	"out vec4 FragColor;\n"
+	"in vec2 cell;\n"
+	"uniform sampler2D airborne;\n"
+	"uniform float peak;\n"
+	"void main()\n"
+	"{\n"
+	"	float amount=texture(airborne,cell).r/peak;\n"
+	"	if (amount<=0.0) discard;\n"
+	"	FragColor=vec4(1.0,0.0,1.0,0.6*sqrt(min(amount,1.0)));\n"
+	"}\0";
+
+//Compiles a vertex and a fragment shader and links them into a program
+static unsigned int buildShaderProgram(const char* vertexSource, const char* fragmentSource)
+{
+	//Compile and build the vertex shader program
+	unsigned int vertexShader;
+	vertexShader = glCreateShader(GL_VERTEX_SHADER);
+	glShaderSource(vertexShader, 1, &vertexSource, NULL);
+	glCompileShader(vertexShader);
+
+	//Check if the vertex shader actually built properly. It would be bad to try to render with it if it doesn't work.
+	int success;
+	char infoLog[512];
+	glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
+	//Print out any error messages
+	if (!success) {
+		glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
+		std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
+	}
+
+	//Compile and build the fragment shader program
+	unsigned int fragmentShader;
+	fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+	glShaderSource(fragmentShader, 1, &fragmentSource, NULL);
+	glCompileShader(fragmentShader);
+
+	//Check if the fragment shader built properly
+	glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
+	//Print any error messages
+	if (!success) {
+		glGetShaderInfoLog(fragmentShader, 512, NULL, infoLog);
+		std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
+	}
+
+	//Now we need to link the two shaders into one program
+	unsigned int shaderProgram;
+	shaderProgram = glCreateProgram();
+	glAttachShader(shaderProgram, vertexShader);
+	glAttachShader(shaderProgram, fragmentShader);
+	glLinkProgram(shaderProgram);
+
+	//Check if the program built properly
+	glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
+	if (!success) {
+		glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
+		std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+	}
+
+	//Since the shaders have been built into a program, we can now delete them
+	glDeleteShader(vertexShader);
+	glDeleteShader(fragmentShader);
+
+	return shaderProgram;
+}
+
+static unsigned int generateCircles()
+{
+	//Defines the vertex data that I'd like to use using vector objects
+	vector<double> circle((NUM_CIRCLE_VERTICES + 2) * 3);
+	//The center is (0,0,0) since I'll use the vertex shader to define translations
+
+	//The angle as measured from (0,1,0) clockwise
+	double angle;
+
+	//Makes a ring of vertices to draw with TRIANGLEFAN
+	for (int i = 1;i < NUM_CIRCLE_VERTICES + 2;i++) {
+		angle = (i - 1) * (2 * PI) / NUM_CIRCLE_VERTICES;
+		circle[3 * i] = sin(angle);
+		circle[(3 * i) + 1] = cos(angle);
+	}
+
+
+	//Create a spot in memory for a Vertex Array Object. This will bind together all the calls necessary to send our data to the GPU and interpret it, so that it's easier to call later in the program
+	unsigned int VAO;
+
+	glGenVertexArrays(1, &VAO);
+
+	//Creates a spot in memory for a handle to the Vertex Buffer Object
+	unsigned int VBO;
+
+	//Creates the Vertex Buffer Object and stores the handle in the spot in memory that we specify
+	glGenBuffers(1, &VBO);
+
+	//Sets the Vertex Array Object, so that further calls describing the buffer and interpretation are stored within that instance.
+	glBindVertexArray(VAO);
+
+	//Binds the GL array buffer to the buffer object that we just created
+	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+
+	//Sends the vertex data to the data buffer and tells it that we won't be changing this data often (which affects how the graphics card stores the data)
+	glBufferData(GL_ARRAY_BUFFER, circle.size() * sizeof(double), circle.data(), GL_STATIC_DRAW);
+
+	//Defines how to process the data we sent in
+	glVertexAttribPointer(0, 3, GL_DOUBLE, GL_FALSE, 3 * sizeof(double), (void*)0);
+	glEnableVertexAttribArray(0);
+
+	//The center, radius and state of each circle advance once per circle instead of once per vertex. Where they are read from is set when drawing, as it moves around the instance buffer.
+	glEnableVertexAttribArray(1);
+	glVertexAttribDivisor(1, 1);
+	glEnableVertexAttribArray(2);
+	glVertexAttribDivisor(2, 1);
+
+	//Now that we've finished making all of those definitions, tell OpenGL to stop writing things to those objects so that future statements don't accidentally modify them.
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindVertexArray(0);
+
+	return VAO;
+}
+
+static unsigned int generateQuads()
+{
+	//The quads are built in the vertex shader, so all this needs is the per-circle attributes. Where they are read from is set when drawing.
+	unsigned int VAO;
+	glGenVertexArrays(1, &VAO);
+	glBindVertexArray(VAO);
+	glEnableVertexAttribArray(1);
+	glVertexAttribDivisor(1, 1);
+	glEnableVertexAttribArray(2);
+	glVertexAttribDivisor(2, 1);
+	glBindVertexArray(0);
+
+	return VAO;
+}
+
+static unsigned int generateDensityTexture()
+{
+	//Two texels per cell of the histogram, holding the counts of the six states. The counts are read as integers, so there is no filtering.
+	unsigned int texture;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB32UI, 2 * DENSITY_RESOLUTION, DENSITY_RESOLUTION, 0, GL_RGB_INTEGER, GL_UNSIGNED_INT, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	return texture;
+}
+
+static void drawInstances(RenderMode mode, unsigned int VAO, InstanceStream& instances, int region, size_t count, double boxSize, int shaderProgram) {
+	//Tells OpenGL to use the shaders that we custom made
+	glUseProgram(shaderProgram);
+
+	//Tells OpenGL how to get the data properly transmitted. Every circle is drawn from the same mesh.
+	glBindVertexArray(VAO);
+
+	//Points the per-circle attributes at the region of the instance buffer that holds the snapshot being drawn
+	glBindBuffer(GL_ARRAY_BUFFER, instances.getBuffer());
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(CircleInstance), (void*)instances.getOffset(region));
+	glVertexAttribIPointer(2, 1, GL_UNSIGNED_INT, sizeof(CircleInstance), (void*)(instances.getOffset(region) + offsetof(CircleInstance, state)));
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	//Everything is scaled so the box fills the viewport
+	glUniform1f(glGetUniformLocation(shaderProgram, "scale"), (float)(1.0 / boxSize));
+
+	//Draw all of the circles at once. Yay!
+	if (mode == RENDER_SDF) {
+		//The viewport is square, and spans 2 units across
+		int viewport[4];
+		glGetIntegerv(GL_VIEWPORT, viewport);
+		glUniform1f(glGetUniformLocation(shaderProgram, "pixelSize"), 2.0f / (viewport[2] > 0 ? viewport[2] : 1));
+
+		//The edges are blended with whatever is behind them
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, (GLsizei)count);
+		glDisable(GL_BLEND);
+	}
+	else {
+		glDrawArraysInstanced(GL_TRIANGLE_FAN, 0, NUM_CIRCLE_VERTICES + 2, (GLsizei)count);
+	}
+	glBindVertexArray(0);
+
+	//The region can't be written again until the GPU is done drawing from it
+	instances.fence(region);
+}
+
+Renderer::Renderer()
+{
+	shaderProgram = 0;
+	sdfShaderProgram = 0;
+	densityShaderProgram = 0;
+	circleVAO = 0;
+	quadVAO = 0;
+	densityVAO = 0;
+	densityTexture = 0;
+	densityPeak = 0;
+	airborneShaderProgram = 0;
+	airborneTexture = 0;
+	airborneResolution = 0;
+	airbornePeak = 0;
+}
+
+void Renderer::create()
+{
+	//Build the ways of drawing the circles: a triangle fan mesh, one quad per circle shaded with its signed distance, and the density heatmap
+	shaderProgram = buildShaderProgram(vertexShaderSource, fragmentShaderSource);
+	sdfShaderProgram = buildShaderProgram(sdfVertexShaderSource, sdfFragmentShaderSource);
+	densityShaderProgram = buildShaderProgram(densityVertexShaderSource, densityFragmentShaderSource);
+	airborneShaderProgram = buildShaderProgram(densityVertexShaderSource, airborneFragmentShaderSource);
+
+	//The colors of the agent states: uninfected circles are blue, infected ones red and recovered ones green. Exposed ones are yellow, presymptomatic ones orange and asymptomatic ones purple.
+	const float colors[NUM_AGENT_STATES][3] = { { 0.0f, 0.0f, 1.0f }, { 1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, { 1.0f, 1.0f, 0.0f }, { 1.0f, 0.5f, 0.0f }, { 0.6f, 0.0f, 0.8f } };
+	glUseProgram(shaderProgram);
+	glUniform3fv(glGetUniformLocation(shaderProgram, "colors"), NUM_AGENT_STATES, *colors);
+	glUseProgram(sdfShaderProgram);
+	glUniform3fv(glGetUniformLocation(sdfShaderProgram, "colors"), NUM_AGENT_STATES, *colors);
+	glUseProgram(densityShaderProgram);
+	glUniform3fv(glGetUniformLocation(densityShaderProgram, "colors"), NUM_AGENT_STATES, *colors);
+	glUseProgram(0);
+
+	//Generate the circle mesh, the attribute-less quads and the density texture
+	circleVAO = generateCircles();
+	quadVAO = generateQuads();
+	densityTexture = generateDensityTexture();
+
+	//The heatmap quad has no attributes at all, so it gets a vertex array object without any
+	glGenVertexArrays(1, &densityVAO);
+
+	//The concentrations are smooth, so unlike the counts they are filtered. The texture is only sized once the first field comes in.
+	glGenTextures(1, &airborneTexture);
+	glBindTexture(GL_TEXTURE_2D, airborneTexture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	airborneResolution = 0;
+}
+
+void Renderer::destroy()
+{
+	glDeleteProgram(shaderProgram);
+	glDeleteProgram(sdfShaderProgram);
+	glDeleteProgram(densityShaderProgram);
+	glDeleteProgram(airborneShaderProgram);
+	glDeleteVertexArrays(1, &circleVAO);
+	glDeleteVertexArrays(1, &quadVAO);
+	glDeleteVertexArrays(1, &densityVAO);
+	glDeleteTextures(1, &densityTexture);
+	glDeleteTextures(1, &airborneTexture);
+	shaderProgram = sdfShaderProgram = densityShaderProgram = airborneShaderProgram = 0;
+	circleVAO = quadVAO = densityVAO = densityTexture = airborneTexture = 0;
+	airborneResolution = 0;
+}
+
+void Renderer::drawCircles(RenderMode mode, InstanceStream& instances, int region, size_t count, double boxSize)
+{
+	if (mode == RENDER_SDF) {
+		drawInstances(RENDER_SDF, quadVAO, instances, region, count, boxSize, sdfShaderProgram);
+	}
+	else {
+		drawInstances(RENDER_MESH, circleVAO, instances, region, count, boxSize, shaderProgram);
+	}
+}
+
+void Renderer::uploadDensity(const vector<unsigned int>& counts, unsigned int peak)
+{
+	//Row 0 of the histogram is the bottom of the box, which is also the bottom of the texture
+	glBindTexture(GL_TEXTURE_2D, densityTexture);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 2 * DENSITY_RESOLUTION, DENSITY_RESOLUTION, GL_RGB_INTEGER, GL_UNSIGNED_INT, counts.data());
+	glBindTexture(GL_TEXTURE_2D, 0);
+	densityPeak = peak;
+}
+
+void Renderer::drawDensity()
+{
+	glUseProgram(densityShaderProgram);
+	glBindVertexArray(densityVAO);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, densityTexture);
+	glUniform1i(glGetUniformLocation(densityShaderProgram, "density"), 0);
+	glUniform1f(glGetUniformLocation(densityShaderProgram, "peak"), (float)log(1.0 + (densityPeak > 0 ? densityPeak : 1)));
+
+	//The viewport is the box, so one quad over all of it shows every cell
+	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glBindVertexArray(0);
+}
+
+void Renderer::uploadAirborne(const vector<float>& concentration, int resolution, float peak)
+{
+	//Row 0 of the field is the bottom of the box, like the histogram
+	glBindTexture(GL_TEXTURE_2D, airborneTexture);
+	if (resolution != airborneResolution) {
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, resolution, resolution, 0, GL_RED, GL_FLOAT, concentration.data());
+		airborneResolution = resolution;
+	}
+	else {
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, resolution, resolution, GL_RED, GL_FLOAT, concentration.data());
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+	airbornePeak = peak;
+}
+
+void Renderer::drawAirborne()
+{
+	//Clean air leaves the picture as it is
+	if (airborneResolution == 0 || !(airbornePeak > 0)) {
+		return;
+	}
+
+	glUseProgram(airborneShaderProgram);
+	glBindVertexArray(densityVAO);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, airborneTexture);
+	glUniform1i(glGetUniformLocation(airborneShaderProgram, "airborne"), 0);
+	glUniform1f(glGetUniformLocation(airborneShaderProgram, "peak"), airbornePeak);
+
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+	glDisable(GL_BLEND);
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glBindVertexArray(0);
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include "GL/gl3w.h"
+#include "InstanceStream.h"
+
+//Compile-time replacements:
+#define NUM_CIRCLE_VERTICES 100
+
+//The ways the circles can be drawn
+enum RenderMode
+{
+	//Every circle is a triangle fan of NUM_CIRCLE_VERTICES + 2 vertices
+	RENDER_MESH,
+	//Every circle is a single quad, and the fragment shader cuts the disc out of it with an anti-aliased edge. Far less vertex work, which matters with very many circles.
+	RENDER_SDF,
+	//The circles aren't drawn at all. Instead every cell of a DENSITY_RESOLUTION grid is colored by the mix of states in it and brightened by how many circles it holds, so the frame costs the same however many circles there are.
+	RENDER_DENSITY
+};
+
+//Draws the simulation box into the current viewport, which has to be square. Shared by the window and the offscreen renderer, so both show the same picture.
+class Renderer
+{
+	unsigned int shaderProgram;
+	unsigned int sdfShaderProgram;
+	unsigned int densityShaderProgram;
+	unsigned int circleVAO;
+	unsigned int quadVAO;
+	unsigned int densityVAO;
+	unsigned int densityTexture;
+	unsigned int densityPeak;
+	unsigned int airborneShaderProgram;
+	unsigned int airborneTexture;
+	int airborneResolution;
+	float airbornePeak;
+
+public:
+	Renderer();
+
+	//Needs a current OpenGL context
+	void create();
+	void destroy();
+
+	//Draws count circles from a region of the instance buffer, scaled so the box [-boxSize, boxSize]^2 fills the viewport. mode is RENDER_MESH or RENDER_SDF.
+	void drawCircles(RenderMode mode, InstanceStream& instances, int region, size_t count, double boxSize);
+
+	//Copies a density histogram of DENSITY_RESOLUTION^2 cells with NUM_AGENT_STATES counts each to the GPU. peak is the most circles in a cell.
+	void uploadDensity(const std::vector<unsigned int>& counts, unsigned int peak);
+
+	//Draws the histogram that was uploaded last
+	void drawDensity();
+
+	//Copies the concentration of a resolution x resolution airborne field (see AirborneField) to the GPU. peak is the highest concentration in it.
+	void uploadAirborne(const std::vector<float>& concentration, int resolution, float peak);
+
+	//Tints the viewport by the concentration that was uploaded last, over whatever has been drawn already. The field covers the box, so it lines up with the circles and the density.
+	void drawAirborne();
+};
@@ -0,0 +1,265 @@
+//Drives the simulation over a matrix of population sizes, densities and thread counts, and reports strong and weak scaling.
+//Strong scaling keeps the population fixed and adds threads. Weak scaling grows the population with the threads, so every thread keeps the same share of the work.
+//Every run is written as one row of a CSV file, ready to be plotted.
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Simulation.h"
+
+using namespace std;
+
+struct ScalingRun
+{
+	const char* study;
+	long long agents;
+	int threads;
+	double density;
+	double radius;
+	double boxSize;
+	int steps;
+	double setupSeconds;
+	double seconds;
+	double rate;
+	double speedup;
+	double efficiency;
+};
+
+struct ScalingOptions
+{
+	long long minAgents;
+	long long maxAgents;
+	long long weakAgents;
+	vector<double> densities;
+	vector<int> threads;
+	int steps;
+	int warmup;
+	bool scaleRadius;
+	unsigned long long seed;
+	const char* csvFile;
+};
+
+static void printUsage(const char* program)
+{
+	printf("usage: %s [options]\n", program);
+	printf("  --min-agents N     smallest population of the strong scaling study (default 10000)\n");
+	printf("  --max-agents N     largest population; populations grow tenfold from the smallest (default 10000000)\n");
+	printf("  --weak-agents N    agents per thread in the weak scaling study, 0 to skip it (default 250000)\n");
+	printf("  --densities LIST   comma separated fractions of the box covered by circles (default 0.02,0.1,0.3)\n");
+	printf("  --threads LIST     comma separated thread counts (default 1,2,4,... up to the hardware threads)\n");
+	printf("  --steps N          measured steps per run (default 20)\n");
+	printf("  --warmup N         unmeasured steps before measuring (default 2)\n");
+	printf("  --scale box|radius reach a density by growing the box around circles of radius %g (default), or by shrinking the circles inside a box of half-width %g\n", CIRCLE_RADIUS, BOX_SIZE);
+	printf("  --seed N           random seed (default 1)\n");
+	printf("  --csv FILE         where to write the results (default scaling.csv)\n");
+}
+
+template<class T>
+static bool parseList(const char* text, vector<T>& values)
+{
+	values.clear();
+	const char* cursor = text;
+	while (*cursor != '\0') {
+		char* end;
+		double value = strtod(cursor, &end);
+		if (end == cursor || value <= 0) {
+			return false;
+		}
+		values.push_back((T)value);
+		cursor = *end == ',' ? end + 1 : end;
+	}
+	return !values.empty();
+}
+
+//Runs one configuration and measures the agent-steps per second of the measured steps
+static ScalingRun runConfiguration(const ScalingOptions& options, const char* study, long long agents, int threads, double density)
+{
+	ScalingRun run;
+	run.study = study;
+	run.agents = agents;
+	run.threads = threads;
+	run.density = density;
+	run.steps = options.steps;
+	run.speedup = 1.0;
+	run.efficiency = 1.0;
+
+	//density is the fraction of the box covered: agents * PI * radius^2 / (2 * boxSize)^2
+	if (options.scaleRadius) {
+		run.boxSize = BOX_SIZE;
+		run.radius = sqrt(density * 4.0 * run.boxSize * run.boxSize / (agents * PI));
+	}
+	else {
+		run.radius = CIRCLE_RADIUS;
+		run.boxSize = sqrt(agents * PI * run.radius * run.radius / density) / 2.0;
+	}
+
+	SimulationSettings settings;
+	settings.numCircles = (int)agents;
+	settings.circleRadius = run.radius;
+	settings.boxSize = run.boxSize;
+	settings.numThreads = threads;
+	settings.seed = options.seed;
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	Simulation simulation(settings);
+	simulation.createCircles();
+	run.setupSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	for (int step = 0;step < options.warmup;step++) {
+		simulation.circleMotion();
+	}
+
+	start = chrono::steady_clock::now();
+	for (int step = 0;step < options.steps;step++) {
+		simulation.circleMotion();
+	}
+	run.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	run.rate = (double)agents * options.steps / run.seconds;
+
+	return run;
+}
+
+static void printHeader()
+{
+	printf("%12s %8s %8s %10s %12s %10s %16s %20s %9s %10s\n", "agents", "threads", "density", "radius", "box", "setup s", "agent-steps/s", "agent-steps/s/thread", "speedup", "efficiency");
+}
+
+static void printRun(const ScalingRun& run)
+{
+	printf("%12lld %8d %8.3f %10.5f %12.3f %10.3f %16.4g %20.4g %9.2f %9.1f%%\n", run.agents, run.threads, run.density, run.radius, run.boxSize, run.setupSeconds, run.rate, run.rate / run.threads, run.speedup, run.efficiency * 100.0);
+	fflush(stdout);
+}
+
+int main(int argc, char** argv)
+{
+	ScalingOptions options;
+	options.minAgents = 10000;
+	options.maxAgents = 10000000;
+	options.weakAgents = 250000;
+	options.densities.push_back(0.02);
+	options.densities.push_back(0.1);
+	options.densities.push_back(0.3);
+	options.steps = 20;
+	options.warmup = 2;
+	options.scaleRadius = false;
+	options.seed = 1;
+	options.csvFile = "scaling.csv";
+
+	int hardwareThreads = (int)thread::hardware_concurrency();
+	if (hardwareThreads < 1) {
+		hardwareThreads = 1;
+	}
+	for (int threads = 1;threads < hardwareThreads;threads *= 2) {
+		options.threads.push_back(threads);
+	}
+	options.threads.push_back(hardwareThreads);
+
+	for (int i = 1;i < argc;i++) {
+		bool valid = true;
+		if (strcmp(argv[i], "--min-agents") == 0 && i + 1 < argc) {
+			options.minAgents = atoll(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--max-agents") == 0 && i + 1 < argc) {
+			options.maxAgents = atoll(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--weak-agents") == 0 && i + 1 < argc) {
+			options.weakAgents = atoll(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--densities") == 0 && i + 1 < argc) {
+			valid = parseList(argv[++i], options.densities);
+		}
+		else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+			valid = parseList(argv[++i], options.threads);
+		}
+		else if (strcmp(argv[i], "--steps") == 0 && i + 1 < argc) {
+			options.steps = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) {
+			options.warmup = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--scale") == 0 && i + 1 < argc) {
+			i++;
+			options.scaleRadius = strcmp(argv[i], "radius") == 0;
+			valid = options.scaleRadius || strcmp(argv[i], "box") == 0;
+		}
+		else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+			options.seed = strtoull(argv[++i], NULL, 10);
+		}
+		else if (strcmp(argv[i], "--csv") == 0 && i + 1 < argc) {
+			options.csvFile = argv[++i];
+		}
+		else {
+			printUsage(argv[0]);
+			return strcmp(argv[i], "--help") == 0 ? 0 : 1;
+		}
+
+		if (!valid) {
+			printUsage(argv[0]);
+			return 1;
+		}
+	}
+
+	//The agent indices are stored as 32 bit integers
+	if (options.minAgents < 1 || options.maxAgents < options.minAgents || options.maxAgents > 2000000000LL || options.weakAgents < 0 || options.steps < 1 || options.warmup < 0) {
+		printUsage(argv[0]);
+		return 1;
+	}
+
+	FILE* csv = fopen(options.csvFile, "w");
+	if (csv == NULL) {
+		fprintf(stderr, "Failed to open %s\n", options.csvFile);
+		return 1;
+	}
+	fprintf(csv, "study,agents,threads,density,radius,box_size,steps,setup_seconds,seconds,agent_steps_per_second,agent_steps_per_second_per_thread,speedup,efficiency\n");
+
+	vector<ScalingRun> runs;
+
+	//Strong scaling: the speedup and efficiency of every run are relative to the run with the first thread count of the list, at the same population and density
+	printf("strong scaling\n");
+	printHeader();
+	for (long long agents = options.minAgents;agents <= options.maxAgents;agents *= 10) {
+		for (size_t d = 0;d < options.densities.size();d++) {
+			size_t baseline = runs.size();
+			for (size_t t = 0;t < options.threads.size();t++) {
+				ScalingRun run = runConfiguration(options, "strong", agents, options.threads[t], options.densities[d]);
+				run.speedup = run.rate / (t == 0 ? run.rate : runs[baseline].rate);
+				run.efficiency = run.speedup * options.threads[0] / run.threads;
+				runs.push_back(run);
+				printRun(run);
+			}
+		}
+	}
+
+	//Weak scaling: every thread gets weakAgents agents, so ideally the agent-steps per second per thread stay the same
+	if (options.weakAgents > 0) {
+		printf("\nweak scaling\n");
+		printHeader();
+		for (size_t d = 0;d < options.densities.size();d++) {
+			size_t baseline = runs.size();
+			for (size_t t = 0;t < options.threads.size();t++) {
+				ScalingRun run = runConfiguration(options, "weak", options.weakAgents * options.threads[t], options.threads[t], options.densities[d]);
+				double perThread = run.rate / run.threads;
+				double baselinePerThread = t == 0 ? perThread : runs[baseline].rate / runs[baseline].threads;
+				run.speedup = run.rate / (t == 0 ? run.rate : runs[baseline].rate);
+				run.efficiency = perThread / baselinePerThread;
+				runs.push_back(run);
+				printRun(run);
+			}
+		}
+	}
+
+	for (size_t i = 0;i < runs.size();i++) {
+		const ScalingRun& run = runs[i];
+		fprintf(csv, "%s,%lld,%d,%g,%g,%g,%d,%g,%g,%g,%g,%g,%g\n", run.study, run.agents, run.threads, run.density, run.radius, run.boxSize, run.steps, run.setupSeconds, run.seconds, run.rate, run.rate / run.threads, run.speedup, run.efficiency);
+	}
+	fclose(csv);
+	printf("\nwrote %s\n", options.csvFile);
+
+	return 0;
+}
@@ -0,0 +1,1102 @@
+#include "Simulation.h"
+#include "Profiler.h"
+#include "Random.h"
+#include "PoissonPlacement.h"
+
+#include <time.h>
+#include <math.h>
+
+using namespace std;
+
+SimulationSettings::SimulationSettings()
+{
+	numCircles = NUM_CIRCLES;
+	circleRadius = CIRCLE_RADIUS;
+	radiusRatio = RADIUS_RATIO;
+	circleSpeed = CIRCLE_SPEED;
+	boxSize = BOX_SIZE;
+	periodic = false;
+	framerate = FRAMERATE;
+	infectionChance = INFECTION_CHANCE;
+	transmissionRadius = TRANSMISSION_RADIUS;
+	transmissionKernel = KERNEL_FLAT;
+	infectiousDose = INFECTIOUS_DOSE;
+	airborneEmission = AIRBORNE_EMISSION;
+	airborneIntake = AIRBORNE_INTAKE;
+	airborneDiffusion = AIRBORNE_DIFFUSION;
+	airborneDecay = AIRBORNE_DECAY;
+	airborneResolution = AIRBORNE_RESOLUTION;
+	avgLatency = AVG_LATENCY;
+	asymptomaticFraction = ASYMPTOMATIC_FRACTION;
+	avgPresymptomatic = AVG_PRESYMPTOMATIC;
+	avgRecovery = AVG_RECOVERY;
+	recoveryDistribution = RECOVERY_GEOMETRIC;
+	recoveryVariation = RECOVERY_VARIATION;
+	immunity = IMMUNITY;
+	numThreads = 0;
+	broadPhase = BROADPHASE_GRID;
+	placement = PLACEMENT_UNIFORM;
+	spacedPlacement = true;
+	stationaryFraction = STATIONARY_FRACTION;
+	verletSkin = VERLET_SKIN;
+	reorderInterval = REORDER_INTERVAL;
+	seed = (unsigned long long)time(NULL);
+}
+
+Simulation::Simulation(const SimulationSettings& settings) : settings(settings), pool(settings.numThreads)
+{
+	maxRadius = settings.circleRadius;
+	step = 0;
+	instanceOutput = NULL;
+	neighborListExpired = true;
+	neighborListBuilds = 0;
+	crowdedAgents = 0;
+	movingCount = 0;
+	stationaryGridExpired = true;
+	for (int i = 0;i < NUM_AGENT_STATES;i++) {
+		stateCounts[i] = 0;
+	}
+	threadStateChanges.assign(pool.size() * STATE_COUNT_STRIDE, 0);
+	threadInfections.resize(pool.size());
+
+	//The other broad phases don't know about the wrap-around, so a periodic box falls back to the grid
+	if (settings.periodic && settings.broadPhase != BROADPHASE_GRID && settings.broadPhase != BROADPHASE_PAIRWISE) {
+		this->settings.broadPhase = BROADPHASE_GRID;
+	}
+
+	//Nor do the Verlet lists and the sweep, which look up the neighbors of an agent by its index, know about the stationary agents
+	if (settings.stationaryFraction > 0 && (settings.broadPhase == BROADPHASE_VERLET || settings.broadPhase == BROADPHASE_SWEEP)) {
+		this->settings.broadPhase = BROADPHASE_GRID;
+	}
+
+	//A uniform number (bits >> 11) / 2^53 is below a chance exactly when bits >> 11 is below the chance times 2^53, rounded up
+	groupCount = settings.contacts.empty() ? 1 : settings.contacts.getGroups();
+	transmissionThreshold.resize((size_t)groupCount * groupCount * TRANSMISSION_KERNEL_SIZE);
+	for (int source = 0;source < groupCount;source++) {
+		for (int target = 0;target < groupCount;target++) {
+			double infectionChance = settings.contacts.empty() ? settings.infectionChance : settings.contacts.chance(source, target);
+			unsigned long long* thresholds = &transmissionThreshold[((size_t)source * groupCount + target) * TRANSMISSION_KERNEL_SIZE];
+			for (int i = 0;i < TRANSMISSION_KERNEL_SIZE;i++) {
+				double distanceSquared = (i + 0.5) / TRANSMISSION_KERNEL_SIZE;
+				double kernel = 1;
+				if (settings.transmissionKernel == KERNEL_LINEAR) {
+					kernel = 1 - sqrt(distanceSquared);
+				}
+				else if (settings.transmissionKernel == KERNEL_GAUSSIAN) {
+					kernel = exp(-2 * distanceSquared);
+				}
+				double chance = infectionChance * kernel;
+				chance = chance < 0 ? 0 : chance > 1 ? 1 : chance;
+				thresholds[i] = (unsigned long long)ceil(chance * 9007199254740992.0);
+			}
+		}
+	}
+}
+
+//A standard normal number from two uniform ones (Box-Muller). draw counts the random numbers an agent has used up so far, so every call gets new ones.
+static double randomNormal(unsigned long long seed, unsigned long long step, unsigned int agent, unsigned long long& draw)
+{
+	double u = 1 - randomUniform(seed, RANDOM_RECOVERY, step, agent, draw++);
+	double v = randomUniform(seed, RANDOM_RECOVERY, step, agent, draw++);
+	return sqrt(-2 * log(u)) * cos(2 * PI * v);
+}
+
+//A gamma distributed number with the given shape and a scale of 1 (Marsaglia and Tsang)
+static double randomGamma(double shape, unsigned long long seed, unsigned long long step, unsigned int agent, unsigned long long& draw)
+{
+	//Shapes below 1 are sampled with the shape raised by 1, then scaled back down
+	double boost = 1;
+	if (shape < 1) {
+		boost = pow(1 - randomUniform(seed, RANDOM_RECOVERY, step, agent, draw++), 1 / shape);
+		shape += 1;
+	}
+
+	double d = shape - 1.0 / 3;
+	double c = 1 / sqrt(9 * d);
+	while (true) {
+		double z = randomNormal(seed, step, agent, draw);
+		double v = 1 + c * z;
+		if (v <= 0) {
+			continue;
+		}
+		v = v * v * v;
+		double u = 1 - randomUniform(seed, RANDOM_RECOVERY, step, agent, draw++);
+		if (log(u) < 0.5 * z * z + d - d * v + d * log(v)) {
+			return d * v * boost;
+		}
+	}
+}
+
+//Which state an infected agent becomes infectious in
+unsigned char Simulation::onsetState(unsigned int id, unsigned long long onsetStep) const
+{
+	if (settings.asymptomaticFraction > 0 && randomUniform(settings.seed, RANDOM_PROGRESSION, onsetStep, id) < settings.asymptomaticFraction) {
+		return ASYMPTOMATIC;
+	}
+	return settings.avgPresymptomatic > 0 ? PRESYMPTOMATIC : INFECTED;
+}
+
+//The mean length of the stage an agent in the state is in
+double Simulation::stageSeconds(unsigned char state) const
+{
+	if (state == EXPOSED) {
+		return settings.avgLatency;
+	}
+	if (state == PRESYMPTOMATIC) {
+		return settings.avgPresymptomatic;
+	}
+	return settings.avgRecovery;
+}
+
+//How many steps the stage of the agent with the id that starts in startStep lasts, at least 1, for a mean of seconds. Only depends on the seed, the agent and the step, like every other random decision.
+//An agent never starts two stages in the same step, so every stage draws different random numbers.
+unsigned long long Simulation::stageSteps(unsigned int agent, unsigned long long startStep, double seconds) const
+{
+	unsigned long long seed = settings.seed;
+	double mean = seconds * settings.framerate;
+	double variation = settings.recoveryVariation;
+	unsigned long long draw = 0;
+	double steps = mean;
+
+	if (settings.recoveryDistribution == RECOVERY_GEOMETRIC) {
+		//The number of coin flips up to the first success, each with a chance of 1 / mean
+		double chance = 1 / mean;
+		if (!(chance < 1)) {
+			return 1;
+		}
+		steps = 1 + floor(log(1 - randomUniform(seed, RANDOM_RECOVERY, startStep, agent, draw)) / log1p(-chance));
+	}
+	else if (variation > 0 && settings.recoveryDistribution == RECOVERY_GAMMA) {
+		double shape = 1 / (variation * variation);
+		steps = randomGamma(shape, seed, startStep, agent, draw) * mean / shape;
+	}
+	else if (variation > 0 && settings.recoveryDistribution == RECOVERY_LOGNORMAL) {
+		double sigmaSquared = log1p(variation * variation);
+		steps = exp(log(mean) - 0.5 * sigmaSquared + sqrt(sigmaSquared) * randomNormal(seed, startStep, agent, draw));
+	}
+
+	//Round to whole steps, and keep absurdly long ones from overflowing
+	if (!(steps >= 1.5)) {
+		return 1;
+	}
+	if (steps > 1e15) {
+		return 1000000000000000ULL;
+	}
+	return (unsigned long long)(steps + 0.5);
+}
+
+void Simulation::createCircles()
+{
+	size_t amount = settings.numCircles > 0 ? (size_t)settings.numCircles : 0;
+	unsigned long long seed = settings.seed;
+	double boxSize = settings.boxSize;
+
+	current.x.resize(amount);
+	current.y.resize(amount);
+	current.vx.resize(amount);
+	current.vy.resize(amount);
+	current.radius.resize(amount);
+	current.state.resize(amount);
+	current.id.resize(amount);
+	current.mobile.resize(amount);
+	current.group.resize(amount);
+	agentIndex.resize(amount);
+	next.x.resize(amount);
+	next.y.resize(amount);
+	next.vx.resize(amount);
+	next.vy.resize(amount);
+	next.state.resize(amount);
+	infectedSlot.resize(amount);
+	infectedAgents.clear();
+	exposures.clear();
+	if (settings.airborneEmission > 0) {
+		airborne.create(boxSize, settings.airborneResolution, settings.periodic, pool);
+	}
+	infectionClaims.reset(new atomic<unsigned long long>[amount]);
+
+	maxRadius = settings.radiusRatio > 1 ? settings.circleRadius * settings.radiusRatio : settings.circleRadius;
+	step = 0;
+	neighborListExpired = true;
+	neighborListBuilds = 0;
+	stationaryGridExpired = true;
+	for (int i = 0;i < NUM_AGENT_STATES;i++) {
+		stateCounts[i] = 0;
+	}
+	stateCounts[SUSCEPTIBLE] = amount;
+
+	//The circles have to start inside the box
+	double inside = boxSize - settings.circleRadius;
+	if (inside < 0) {
+		inside = 0;
+	}
+
+	//The walls have to be known before anything is placed. The field only has to reach as far as the biggest circle.
+	walls.clear();
+	if (!settings.obstacles.empty()) {
+		walls.build(settings.obstacles, boxSize, settings.circleRadius / WALL_FIELD_CELLS_PER_RADIUS, 2.0 * maxRadius, pool);
+	}
+
+	//Every cluster center is keyed by its number, so all threads agree on where it is
+	double clusterX[PLACEMENT_CLUSTERS];
+	double clusterY[PLACEMENT_CLUSTERS];
+	for (int cluster = 0;cluster < PLACEMENT_CLUSTERS;cluster++) {
+		clusterX[cluster] = (randomUniform(seed, RANDOM_PLACEMENT, 3, cluster) * 2 - 1) * boxSize;
+		clusterY[cluster] = (randomUniform(seed, RANDOM_PLACEMENT, 4, cluster) * 2 - 1) * boxSize;
+	}
+	const DensityMap& densityMap = settings.densityMap;
+	bool mapped = settings.placement == PLACEMENT_DENSITY_MAP && !densityMap.empty() && densityMap.getMax() > 0;
+
+	//The first spaced agents are placed without overlaps, in proportion to the same densities the agents are drawn from one by one below
+	size_t spaced = 0;
+	if (settings.spacedPlacement) {
+		PoissonPlacement poisson;
+		poisson.setWalls(walls.empty() ? NULL : &walls);
+		double spread = PLACEMENT_SPREAD * boxSize;
+		spaced = poisson.place(amount, boxSize, settings.circleRadius, settings.radiusRatio, seed, pool, [&](double positionX, double positionY) {
+			//Nobody can stand inside a solid obstacle
+			if (!walls.empty() && walls.distance(positionX, positionY) < 0) {
+				return 0.0;
+			}
+			if (settings.placement == PLACEMENT_CORRIDOR) {
+				return fabs(positionY) < spread ? 1.0 : 0.0;
+			}
+			if (settings.placement == PLACEMENT_CLUSTERED) {
+				double weight = 0;
+				for (int cluster = 0;cluster < PLACEMENT_CLUSTERS;cluster++) {
+					double distanceX = positionX - clusterX[cluster];
+					double distanceY = positionY - clusterY[cluster];
+					weight += exp(-(distanceX * distanceX + distanceY * distanceY) / (2 * spread * spread));
+				}
+				return weight;
+			}
+			if (mapped) {
+				return densityMap.at((positionX + boxSize) / (2 * boxSize), (positionY + boxSize) / (2 * boxSize));
+			}
+			return 1.0;
+		}, current.x.data(), current.y.data(), current.radius.data());
+	}
+	crowdedAgents = settings.spacedPlacement ? amount - spaced : 0;
+
+	pool.parallelFor(amount, pool.grainFor(amount), [&](size_t begin, size_t end, int thread) {
+		for (size_t i = begin < spaced ? spaced : begin;i < end;i++) {
+			current.radius[i] = settings.circleRadius;
+			if (settings.radiusRatio > 1) {
+				//The inverse of the distribution whose density falls off with the cube of the radius, between circleRadius and maxRadius
+				double u = randomUniform(seed, RANDOM_PLACEMENT, 5, i);
+				double radius = settings.circleRadius / sqrt(1 - u * (1 - 1 / (settings.radiusRatio * settings.radiusRatio)));
+				current.radius[i] = radius < maxRadius ? radius : maxRadius;
+			}
+
+			//Positions inside a wall are drawn again
+			for (unsigned long long retry = 0;retry < PLACEMENT_ATTEMPTS;retry++) {
+				//Calculate random position
+				current.x[i] = (randomUniform(seed, RANDOM_PLACEMENT, 0, i, retry) * 2 - 1) * boxSize;
+				current.y[i] = (randomUniform(seed, RANDOM_PLACEMENT, 1, i, retry) * 2 - 1) * boxSize;
+				if (settings.placement == PLACEMENT_CORRIDOR) {
+					current.y[i] *= PLACEMENT_SPREAD;
+				}
+				else if (settings.placement == PLACEMENT_CLUSTERED) {
+					unsigned long long cluster = i % PLACEMENT_CLUSTERS;
+					double distance = sqrt(-2 * log(1 - randomUniform(seed, RANDOM_PLACEMENT, 0, i, retry))) * PLACEMENT_SPREAD * boxSize;
+					double direction = randomUniform(seed, RANDOM_PLACEMENT, 1, i, retry) * 2 * PI;
+					current.x[i] = fmin(fmax(clusterX[cluster] + distance * cos(direction), -inside), inside);
+					current.y[i] = fmin(fmax(clusterY[cluster] + distance * sin(direction), -inside), inside);
+				}
+				else if (mapped) {
+					//Rejection sampling: a random point is kept with a chance of its brightness
+					for (unsigned long long attempt = retry * PLACEMENT_ATTEMPTS;attempt < (retry + 1) * PLACEMENT_ATTEMPTS;attempt++) {
+						double u = randomUniform(seed, RANDOM_PLACEMENT, 9, i, attempt);
+						double v = randomUniform(seed, RANDOM_PLACEMENT, 10, i, attempt);
+						current.x[i] = (u * 2 - 1) * inside;
+						current.y[i] = (v * 2 - 1) * inside;
+						if (randomUniform(seed, RANDOM_PLACEMENT, 11, i, attempt) * densityMap.getMax() < densityMap.at(u, v)) {
+							break;
+						}
+					}
+				}
+				if (walls.empty() || walls.distance(current.x[i], current.y[i]) >= current.radius[i]) {
+					break;
+				}
+			}
+		}
+
+		for (size_t i = begin;i < end;i++) {
+			//Calculate random velocity angle, and from it the Cartesian components of the velocity
+			double angle = randomUniform(seed, RANDOM_PLACEMENT, 2, i) * 2 * PI;
+			current.vx[i] = cos(angle);
+			current.vy[i] = sin(angle);
+
+			//The shares of the groups split [0, 1) into consecutive ranges, and the agent is in the one a random number falls into
+			unsigned char group = 0;
+			if (!settings.contacts.empty()) {
+				double u = randomUniform(seed, RANDOM_PLACEMENT, 13, i);
+				double upTo = settings.contacts.share(0);
+				while (group < groupCount - 1 && u >= upTo) {
+					group++;
+					upTo += settings.contacts.share(group);
+				}
+			}
+			current.group[i] = group;
+
+			//A stationary agent never moves, but still bounces the others off
+			current.mobile[i] = randomUniform(seed, RANDOM_PLACEMENT, 12, i) < settings.stationaryFraction ? 0 : 1;
+			if (!current.mobile[i]) {
+				current.vx[i] = 0;
+				current.vy[i] = 0;
+			}
+
+			//Everyone starts out uninfected
+			current.state[i] = SUSCEPTIBLE;
+			current.id[i] = (unsigned int)i;
+			agentIndex[i] = (unsigned int)i;
+			infectionClaims[i].store(0, memory_order_relaxed);
+		}
+	});
+
+	movingCount = 0;
+	for (size_t i = 0;i < amount;i++) {
+		movingCount += current.mobile[i];
+	}
+
+	//The agents are in the order of the placement cells at best, and in random order at worst, which is the worst order for the neighbor lookups.
+	//This is also what moves the stationary agents behind the moving ones.
+	if (settings.reorderInterval > 0 || movingCount < amount) {
+		reorder();
+	}
+
+	//Check for circle overlap before the program starts
+	circleCollision();
+
+	//Start an infection. Note that I've done this after the collision detection has already run once, so that any circles that were initially overlapping don't infect each other
+	//It counts as caught in the step before the first one, so it can recover as early as the first step. It skips the latent period.
+	stageChanges.clear(step);
+	if (amount > 0) {
+		unsigned int first = agentIndex[0];
+		stateCounts[current.state[first]]--;
+		current.state[first] = INFECTED;
+		stateCounts[INFECTED]++;
+		infectedSlot[0] = 0;
+		infectedAgents.push_back(0);
+		stageChanges.schedule(0, step + stageSteps(0, step, settings.avgRecovery) - 1);
+	}
+}
+
+void Simulation::circleMotion()
+{
+	if (settings.reorderInterval > 0 && step > 0 && step % settings.reorderInterval == 0) {
+		reorder();
+	}
+	buildBroadPhase();
+
+	collide<true>();
+	infect();
+	swapBuffers();
+	advanceStages();
+	mergeStateCounts();
+	scheduleInfections();
+	step++;
+}
+
+void Simulation::circleCollision()
+{
+	buildBroadPhase();
+
+	collide<false>();
+	infect();
+	swapBuffers();
+	mergeStateCounts();
+	scheduleInfections();
+}
+
+//The collision pass: the moving agents are collided and moved, and the stationary ones only carried over into next
+template<bool MOVE>
+void Simulation::collide()
+{
+	PROFILE_PHASE(PHASE_COLLISION);
+	pool.parallelFor(movingCount, pool.grainFor(movingCount), [&](size_t begin, size_t end, int thread) {
+		if (settings.periodic) {
+			collideRange<MOVE, true>(begin, end);
+		}
+		else {
+			collideRange<MOVE, false>(begin, end);
+		}
+	});
+
+	size_t stationary = current.size() - movingCount;
+	if (stationary > 0) {
+		pool.parallelFor(stationary, pool.grainFor(stationary, 4096), [&](size_t begin, size_t end, int thread) {
+			copyStationaryRange(movingCount + begin, movingCount + end);
+		});
+	}
+}
+
+void Simulation::writeInstances(CircleInstance* instances)
+{
+	pool.parallelFor(current.size(), pool.grainFor(current.size()), [&](size_t begin, size_t end, int thread) {
+		for (size_t i = begin;i < end;i++) {
+			instances[i].x = (float)current.x[i];
+			instances[i].y = (float)current.y[i];
+			instances[i].radius = (float)current.radius[i];
+			instances[i].state = current.state[i];
+		}
+	});
+}
+
+unsigned int Simulation::densityHistogram(int resolution, vector<unsigned int>& counts)
+{
+	return density.build(current.x.data(), current.y.data(), current.state.data(), current.size(), NUM_AGENT_STATES, settings.boxSize, resolution, pool, counts);
+}
+
+void Simulation::buildBroadPhase()
+{
+	//The stationary agents don't move, so their grid stays good until they are reordered
+	if (stationaryGridExpired && movingCount < current.size()) {
+		PROFILE_PHASE(PHASE_BROADPHASE);
+		stationaryGrid.build(current.x.data() + movingCount, current.y.data() + movingCount, current.size() - movingCount, settings.boxSize, 2.0 * maxRadius, pool);
+		stationaryGridExpired = false;
+	}
+
+	if (settings.broadPhase == BROADPHASE_GRID) {
+		PROFILE_PHASE(PHASE_BROADPHASE);
+		grid.build(current.x.data(), current.y.data(), movingCount, settings.boxSize, 2.0 * maxRadius, pool);
+	}
+	else if (settings.broadPhase == BROADPHASE_SWEEP) {
+		PROFILE_PHASE(PHASE_BROADPHASE);
+		sweep.build(current.x.data(), current.y.data(), movingCount, pool);
+	}
+	else if (settings.broadPhase == BROADPHASE_HIERARCHICAL) {
+		PROFILE_PHASE(PHASE_BROADPHASE);
+		hierarchy.build(current.x.data(), current.y.data(), current.radius.data(), movingCount, settings.boxSize, settings.circleRadius, pool);
+	}
+	else if (settings.broadPhase == BROADPHASE_VERLET && neighborListExpired) {
+		//Only the steps that rebuild the lists are timed as broad phase, so its call count is the number of rebuilds
+		PROFILE_PHASE(PHASE_BROADPHASE);
+		grid.build(current.x.data(), current.y.data(), movingCount, settings.boxSize, 2.0 * maxRadius, pool);
+
+		//The lists have to cover both colliding and passing on the infection
+		double reach = 2.0 * maxRadius;
+		if (settings.transmissionRadius > reach) {
+			reach = settings.transmissionRadius;
+		}
+		neighborList.build(current.x.data(), current.y.data(), movingCount, reach, settings.verletSkin, grid, pool);
+		neighborListExpired = false;
+		neighborListBuilds++;
+	}
+}
+
+void Simulation::mergeStateCounts()
+{
+	for (int i = 0;i < NUM_AGENT_STATES;i++) {
+		long long change = 0;
+		for (int t = 0;t < pool.size();t++) {
+			change += threadStateChanges[t * STATE_COUNT_STRIDE + i];
+			threadStateChanges[t * STATE_COUNT_STRIDE + i] = 0;
+		}
+		stateCounts[i] += change;
+	}
+}
+
+//Moves the agents whose stage is up in this step on to their next one
+void Simulation::advanceStages()
+{
+	changingStage.clear();
+	stageChanges.expire(changingStage);
+	for (size_t i = 0;i < changingStage.size();i++) {
+		unsigned int id = changingStage[i];
+		unsigned int agent = agentIndex[id];
+		unsigned char state = current.state[agent];
+		unsigned char nextState = RECOVERED;
+		if (state == EXPOSED) {
+			nextState = onsetState(id, step);
+		}
+		else if (state == PRESYMPTOMATIC) {
+			nextState = INFECTED;
+		}
+
+		current.state[agent] = nextState;
+		if (instanceOutput != NULL) {
+			instanceOutput[agent].state = nextState;
+		}
+		stateCounts[state]--;
+		stateCounts[nextState]++;
+
+		if (state == EXPOSED) {
+			infectedSlot[id] = (unsigned int)infectedAgents.size();
+			infectedAgents.push_back(id);
+		}
+		if (nextState != RECOVERED) {
+			stageChanges.schedule(id, step + stageSteps(id, step, stageSeconds(nextState)));
+			continue;
+		}
+
+		//Take it off the infectious list by moving the last one into its place
+		unsigned int last = infectedAgents.back();
+		infectedAgents[infectedSlot[id]] = last;
+		infectedSlot[last] = infectedSlot[id];
+		infectedAgents.pop_back();
+	}
+}
+
+//Works out when the agents infected in this step move on to their next stage, and lets the ones that are infectious straight away pass it on from the next step
+void Simulation::scheduleInfections()
+{
+	for (size_t t = 0;t < threadInfections.size();t++) {
+		vector<unsigned int>& infected = threadInfections[t];
+		for (size_t i = 0;i < infected.size();i++) {
+			//The threads collected ids
+			unsigned int id = infected[i];
+			unsigned char state = current.state[agentIndex[id]];
+			if (state != EXPOSED) {
+				infectedSlot[id] = (unsigned int)infectedAgents.size();
+				infectedAgents.push_back(id);
+			}
+			stageChanges.schedule(id, step + stageSteps(id, step, stageSeconds(state)));
+		}
+		infected.clear();
+	}
+}
+
+//Sorts the agents by where they are along a Morton curve, so the agents a lookup visits are mostly next to each other in memory, and updates where every id is.
+//The stationary agents go after the moving ones, each in the order of the curve. Without reorderInterval the agents are only split that way, and otherwise keep their order.
+void Simulation::reorder()
+{
+	PROFILE_PHASE(PHASE_REORDER);
+	size_t n = current.size();
+	if (settings.reorderInterval > 0) {
+		morton.sort(current.x.data(), current.y.data(), n, settings.boxSize, pool, reorderIndices);
+	}
+	else {
+		reorderIndices.resize(n);
+		for (size_t i = 0;i < n;i++) {
+			reorderIndices[i] = (unsigned int)i;
+		}
+	}
+
+	if (movingCount < n) {
+		reorderPartition.resize(n);
+		size_t moving = 0;
+		size_t stationary = movingCount;
+		for (size_t i = 0;i < n;i++) {
+			unsigned int from = reorderIndices[i];
+			if (current.mobile[from]) {
+				reorderPartition[moving++] = from;
+			}
+			else {
+				reorderPartition[stationary++] = from;
+			}
+		}
+		reorderIndices.swap(reorderPartition);
+	}
+
+	reorderRadius.resize(n);
+	reorderIds.resize(n);
+	reorderMobile.resize(n);
+	reorderGroups.resize(n);
+	pool.parallelFor(n, pool.grainFor(n), [&](size_t begin, size_t end, int thread) {
+		for (size_t i = begin;i < end;i++) {
+			unsigned int from = reorderIndices[i];
+			next.x[i] = current.x[from];
+			next.y[i] = current.y[from];
+			next.vx[i] = current.vx[from];
+			next.vy[i] = current.vy[from];
+			next.state[i] = current.state[from];
+			reorderRadius[i] = current.radius[from];
+			reorderIds[i] = current.id[from];
+			reorderMobile[i] = current.mobile[from];
+			reorderGroups[i] = current.group[from];
+			agentIndex[current.id[from]] = (unsigned int)i;
+
+			//The claims only have to tell apart the infections within one step, and this is between steps
+			infectionClaims[i].store(0, memory_order_relaxed);
+		}
+	});
+	swapBuffers();
+	current.radius.swap(reorderRadius);
+	current.id.swap(reorderIds);
+	current.mobile.swap(reorderMobile);
+	current.group.swap(reorderGroups);
+
+	//The collision pass never writes the positions of the stationary agents, so both buffers have to hold them
+	size_t stationary = n - movingCount;
+	pool.parallelFor(stationary, pool.grainFor(stationary), [&](size_t begin, size_t end, int thread) {
+		for (size_t i = movingCount + begin;i < movingCount + end;i++) {
+			next.x[i] = current.x[i];
+			next.y[i] = current.y[i];
+			next.vx[i] = current.vx[i];
+			next.vy[i] = current.vy[i];
+		}
+	});
+
+	//The lists, the sweep order and the stationary grid hold indices
+	neighborListExpired = true;
+	sweep.invalidate();
+	stationaryGridExpired = true;
+}
+
+void Simulation::swapBuffers()
+{
+	current.x.swap(next.x);
+	current.y.swap(next.y);
+	current.vx.swap(next.vx);
+	current.vy.swap(next.vy);
+	current.state.swap(next.state);
+}
+
+//Turns the vector between two agents of a periodic box into the one to the nearest copy of the other agent
+static inline void minimumImage(double& distanceX, double& distanceY, double boxSize)
+{
+	if (distanceX > boxSize) {
+		distanceX -= 2 * boxSize;
+	}else if (distanceX < -boxSize) {
+		distanceX += 2 * boxSize;
+	}
+
+	if (distanceY > boxSize) {
+		distanceY -= 2 * boxSize;
+	}else if (distanceY < -boxSize) {
+		distanceY += 2 * boxSize;
+	}
+}
+
+//Brings a coordinate of a periodic box back into [-boxSize, boxSize)
+static inline void wrapPosition(double& position, double boxSize)
+{
+	if (position >= boxSize) {
+		position -= 2 * boxSize;
+	}else if (position < -boxSize) {
+		position += 2 * boxSize;
+	}
+}
+
+//Works out the next position and velocity of the circles, and copies their states, in [begin, end). Every circle only writes its own entries in next, which is what lets the population be split between threads.
+//Each circle of an overlapping pair moves half of the overlap away from the other, so the pair ends up just touching, the same as when one of them moved the whole way.
+//PERIODIC is settings.periodic as a template parameter, so the reflecting box doesn't pay for the wrap-around checks.
+template<bool MOVE, bool PERIODIC>
+void Simulation::collideRange(size_t begin, size_t end)
+{
+	const double* x = current.x.data();
+	const double* y = current.y.data();
+	const double* radius = current.radius.data();
+	const unsigned char* state = current.state.data();
+	size_t count = current.size();
+
+	double boxSize = settings.boxSize;
+	bool verlet = settings.broadPhase == BROADPHASE_VERLET;
+	bool obstacles = !walls.empty();
+	size_t moving = movingCount;
+	bool stationary = moving < count;
+	bool expired = false;
+
+	for (size_t circle = begin;circle < end;circle++) {
+
+		//Poll the current attributes of the circle of interest
+		double positionX = x[circle];
+		double positionY = y[circle];
+		double velocityX = current.vx[circle];
+		double velocityY = current.vy[circle];
+		double circleRadius = radius[circle];
+		unsigned char circleState = state[circle];
+
+		auto collide = [&](size_t other_circle) {
+			if (other_circle == circle) {
+				return;
+			}
+
+			//Calculates vector between the two circles
+			double distanceX = positionX - x[other_circle];
+			double distanceY = positionY - y[other_circle];
+			if (PERIODIC) {
+				minimumImage(distanceX, distanceY, boxSize);
+			}
+			double reach = circleRadius + radius[other_circle];
+			double magnitudeSquared = distanceX * distanceX + distanceY * distanceY;
+
+			//Most candidate pairs aren't touching, and this rules them out without a square root
+			if (magnitudeSquared >= reach * reach) {
+				return;
+			}
+
+			//The magnitude of the distance vector, and the amount of overlap between the two circles
+			double magnitude = sqrt(magnitudeSquared);
+			double overlap = reach - magnitude;
+
+			//Rounding error is in the 1e-17 spot, so this avoids weird rounding errors that might not shift the circles quite all of the way out of each other
+			if (overlap <= 1e-16) {
+				return;
+			}
+
+			//Convert the displacement vector to a unit vector. Two circles exactly on top of each other get pushed apart along x.
+			if (magnitude > 0) {
+				distanceX = distanceX / magnitude;
+				distanceY = distanceY / magnitude;
+			}
+			else {
+				distanceX = circle < other_circle ? 1.0 : -1.0;
+				distanceY = 0.0;
+			}
+
+			//Shift the position to avoid clipping. A stationary circle doesn't give way, so this one moves the whole overlap.
+			double share = other_circle < moving ? 0.5 : 1.0;
+			positionX = positionX + distanceX * overlap * share;
+			positionY = positionY + distanceY * overlap * share;
+
+			//Adjust the velocity using the reflection formula about the normal vector to the plane of incidence
+			double dot = velocityX * distanceX + velocityY * distanceY;
+			velocityX = velocityX - 2 * dot * distanceX;
+			velocityY = velocityY - 2 * dot * distanceY;
+		};
+
+		if (settings.broadPhase == BROADPHASE_GRID) {
+			if (PERIODIC) {
+				grid.forEachNeighborWrapped(x[circle], y[circle], collide);
+			}
+			else {
+				grid.forEachNeighbor(x[circle], y[circle], collide);
+			}
+		}
+		else if (verlet) {
+			neighborList.forEachNeighbor(circle, collide);
+		}
+		else if (settings.broadPhase == BROADPHASE_SWEEP) {
+			sweep.forEachInRange(circle, circleRadius + maxRadius, collide);
+		}
+		else if (settings.broadPhase == BROADPHASE_HIERARCHICAL) {
+			hierarchy.forEachOverlapping(x[circle], y[circle], circleRadius, collide);
+		}
+		else {
+			for (size_t other_circle = 0;other_circle < moving;other_circle++) {
+				collide(other_circle);
+			}
+		}
+
+		//The broad phases only hold the moving circles, and the stationary ones have a grid of their own
+		if (stationary) {
+			auto collideStationary = [&](size_t other_circle) {
+				collide(moving + other_circle);
+			};
+			if (PERIODIC) {
+				stationaryGrid.forEachNeighborWrapped(x[circle], y[circle], collideStationary);
+			}
+			else {
+				stationaryGrid.forEachNeighbor(x[circle], y[circle], collideStationary);
+			}
+		}
+
+		//Slide out of any wall the circle has run into, and bounce off it if it was heading into it
+		if (obstacles) {
+			double normalX;
+			double normalY;
+			double distance = walls.sample(positionX, positionY, normalX, normalY);
+			double length = sqrt(normalX * normalX + normalY * normalY);
+			if (distance < circleRadius && length > 0) {
+				normalX = normalX / length;
+				normalY = normalY / length;
+				positionX = positionX + normalX * (circleRadius - distance);
+				positionY = positionY + normalY * (circleRadius - distance);
+				double dot = velocityX * normalX + velocityY * normalY;
+				if (dot < 0) {
+					velocityX = velocityX - 2 * dot * normalX;
+					velocityY = velocityY - 2 * dot * normalY;
+				}
+			}
+		}
+
+		//Checks for collisions between the circles and the sides of the box
+		//I've intentionally put this last, as I want the circles to stay inside the box more than I care about them slightly clipping into each other
+		if (!PERIODIC) {
+			if (positionX < -boxSize + circleRadius) {
+				positionX = -boxSize + circleRadius;
+				velocityX = -velocityX;
+			}else if (positionX > boxSize - circleRadius) {
+				positionX = boxSize - circleRadius;
+				velocityX = -velocityX;
+			}
+
+			if (positionY < -boxSize + circleRadius) {
+				positionY = -boxSize + circleRadius;
+				velocityY = -velocityY;
+			}else if (positionY > boxSize - circleRadius) {
+				positionY = boxSize - circleRadius;
+				velocityY = -velocityY;
+			}
+		}
+
+		//Move the circle along its (possibly reflected) velocity
+		if (MOVE) {
+			positionX = positionX + velocityX * settings.circleSpeed;
+			positionY = positionY + velocityY * settings.circleSpeed;
+		}
+
+		//A circle that has left the box comes back in on the other side
+		if (PERIODIC) {
+			wrapPosition(positionX, boxSize);
+			wrapPosition(positionY, boxSize);
+		}
+
+		if (verlet && !expired) {
+			expired = neighborList.movedTooFar(circle, positionX, positionY);
+		}
+
+		//Set the circle attributes as calculated
+		next.x[circle] = positionX;
+		next.y[circle] = positionY;
+		next.vx[circle] = velocityX;
+		next.vy[circle] = velocityY;
+		next.state[circle] = circleState;
+
+		if (instanceOutput != NULL) {
+			instanceOutput[circle].x = (float)positionX;
+			instanceOutput[circle].y = (float)positionY;
+			instanceOutput[circle].radius = (float)circleRadius;
+			instanceOutput[circle].state = circleState;
+		}
+	}
+
+	if (expired) {
+		neighborListExpired.store(true, memory_order_relaxed);
+	}
+}
+
+//Carries the stationary agents in [begin, end) over into the next step. They keep their positions in both buffers, so only their states have to be copied.
+void Simulation::copyStationaryRange(size_t begin, size_t end)
+{
+	for (size_t i = begin;i < end;i++) {
+		next.state[i] = current.state[i];
+	}
+
+	if (instanceOutput != NULL) {
+		for (size_t i = begin;i < end;i++) {
+			instanceOutput[i].x = (float)current.x[i];
+			instanceOutput[i].y = (float)current.y[i];
+			instanceOutput[i].radius = (float)current.radius[i];
+			instanceOutput[i].state = current.state[i];
+		}
+	}
+}
+
+//Lets every infectious agent pass it on to the agents within its reach (touching, or closer than the transmission radius), and through the air. Runs after the collision pass, which has copied every state into next, and only changes the states of the agents that get infected.
+void Simulation::infect()
+{
+	if (settings.airborneEmission > 0) {
+		breathe();
+	}
+
+	//Nobody can be infected without someone infectious, so late in an epidemic this is free. The doses are still dropped, as nobody is building one up anymore.
+	bool dose = settings.infectiousDose > 0;
+	if (infectedAgents.empty() && (!dose || exposures.size() == 0)) {
+		return;
+	}
+
+	PROFILE_PHASE(PHASE_INFECTION);
+	if (dose) {
+		exposures.beginStep(pool);
+	}
+	pool.parallelFor(infectedAgents.size(), pool.grainFor(infectedAgents.size(), 64), [&](size_t begin, size_t end, int thread) {
+		if (settings.periodic) {
+			if (dose) {
+				infectRange<true, true>(begin, end, thread);
+			}
+			else {
+				infectRange<true, false>(begin, end, thread);
+			}
+		}
+		else {
+			if (dose) {
+				infectRange<false, true>(begin, end, thread);
+			}
+			else {
+				infectRange<false, false>(begin, end, thread);
+			}
+		}
+	});
+	if (dose) {
+		exposures.endStep(pool);
+	}
+}
+
+//Lets the infectious agents breathe out into the air, moves the air on by a step, and lets every agent that can catch it breathe in from the cell it is in.
+//The air stays infectious for a while after its sources have recovered, so this only stops once it has cleared out as well.
+void Simulation::breathe()
+{
+	if (infectedAgents.empty() && airborne.clean()) {
+		return;
+	}
+
+	PROFILE_PHASE(PHASE_AIRBORNE);
+	const double* x = current.x.data();
+	const double* y = current.y.data();
+	pool.parallelFor(infectedAgents.size(), pool.grainFor(infectedAgents.size(), 1024), [&](size_t begin, size_t end, int thread) {
+		for (size_t i = begin;i < end;i++) {
+			size_t source = agentIndex[infectedAgents[i]];
+			airborne.emit(x[source], y[source]);
+		}
+	});
+	airborne.update(settings.airborneEmission, settings.airborneDiffusion, settings.airborneDecay, settings.airborneIntake, 1.0 / settings.framerate, pool);
+	if (airborne.clean()) {
+		return;
+	}
+
+	const unsigned char* state = current.state.data();
+	const unsigned int* id = current.id.data();
+	unsigned long long seed = settings.seed;
+	bool immunity = settings.immunity;
+	size_t count = current.size();
+	pool.parallelFor(count, pool.grainFor(count), [&](size_t begin, size_t end, int thread) {
+		long long changes[NUM_AGENT_STATES] = {};
+		for (size_t i = begin;i < end;i++) {
+			unsigned char targetState = state[i];
+			if (targetState != SUSCEPTIBLE && (targetState != RECOVERED || immunity)) {
+				continue;
+			}
+			unsigned long long threshold = airborne.threshold(x[i], y[i]);
+			if (threshold == 0 || (randomBits(seed, RANDOM_AIRBORNE, step, id[i]) >> 11) >= threshold) {
+				continue;
+			}
+			catchInfection(i, targetState, changes, thread);
+		}
+		for (int s = 0;s < NUM_AGENT_STATES;s++) {
+			threadStateChanges[thread * STATE_COUNT_STRIDE + s] += changes[s];
+		}
+	});
+}
+
+//Infects the agent at index target, which is in targetState, unless something else already has in this step. Counts the change into changes, and collects the agent for scheduleInfections().
+inline void Simulation::catchInfection(size_t target, unsigned char targetState, long long* changes, int thread)
+{
+	unsigned long long claim = step + 1;
+	if (infectionClaims[target].exchange(claim, memory_order_relaxed) == claim) {
+		return;
+	}
+
+	unsigned int targetId = current.id[target];
+	unsigned char caught = settings.avgLatency > 0 ? (unsigned char)EXPOSED : onsetState(targetId, step);
+	next.state[target] = caught;
+	if (instanceOutput != NULL) {
+		instanceOutput[target].state = caught;
+	}
+	changes[targetState]--;
+	changes[caught]++;
+	threadInfections[thread].push_back(targetId);
+}
+
+//Checks the agents within reach of the infectious agents in [begin, end) of infectedAgents.
+//DOSE is whether settings.infectiousDose is set, as a template parameter like PERIODIC, so the chance every step doesn't pay for the dose lookups.
+template<bool PERIODIC, bool DOSE>
+void Simulation::infectRange(size_t begin, size_t end, int thread)
+{
+	const double* x = current.x.data();
+	const double* y = current.y.data();
+	const double* radius = current.radius.data();
+	const unsigned char* state = current.state.data();
+	const unsigned int* id = current.id.data();
+	const unsigned char* group = current.group.data();
+	size_t count = current.size();
+	size_t moving = movingCount;
+	bool stationary = moving < count;
+
+	unsigned long long seed = settings.seed;
+	bool immunity = settings.immunity;
+	double transmissionRadius = settings.transmissionRadius;
+	double meanDose = settings.infectiousDose;
+	double stepSeconds = 1.0 / settings.framerate;
+	long long changes[NUM_AGENT_STATES] = {};
+
+	for (size_t i = begin;i < end;i++) {
+		size_t source = agentIndex[infectedAgents[i]];
+		unsigned int sourceId = id[source];
+		double positionX = x[source];
+		double positionY = y[source];
+		double sourceRadius = radius[source];
+		double range = transmissionRadius > 0 ? transmissionRadius : sourceRadius + maxRadius;
+
+		//The thresholds of the source's group, by the group of the target
+		const unsigned long long* thresholds = &transmissionThreshold[(size_t)group[source] * groupCount * TRANSMISSION_KERNEL_SIZE];
+
+		auto transmit = [&](size_t target) {
+			//Only a susceptible agent (or a recovered one, without immunity) can catch it. This also skips the source itself.
+			unsigned char targetState = state[target];
+			if (targetState != SUSCEPTIBLE && (targetState != RECOVERED || immunity)) {
+				return;
+			}
+
+			double distanceX = positionX - x[target];
+			double distanceY = positionY - y[target];
+			if (PERIODIC) {
+				minimumImage(distanceX, distanceY, settings.boxSize);
+			}
+			double reach = transmissionRadius > 0 ? transmissionRadius : sourceRadius + radius[target];
+			double distanceSquared = distanceX * distanceX + distanceY * distanceY;
+			if (distanceSquared >= reach * reach) {
+				return;
+			}
+			unsigned long long threshold = thresholds[group[target] * TRANSMISSION_KERNEL_SIZE + (int)(distanceSquared / (reach * reach) * TRANSMISSION_KERNEL_SIZE)];
+
+			//The random number is keyed by the ids of the pair, so it doesn't matter which thread looks at it, or where the agents are in memory
+			unsigned int targetId = id[target];
+			unsigned int first = sourceId < targetId ? sourceId : targetId;
+			unsigned int second = sourceId < targetId ? targetId : sourceId;
+			if (DOSE) {
+				//A pair that has just come within reach draws the dose it gets infected at. It only ever has one infectious agent, so only this thread sees it.
+				unsigned long long key = exposureKey(first, second);
+				float dose = 0;
+				float infectingDose;
+				if (!exposures.find(key, dose, infectingDose)) {
+					infectingDose = (float)(-log(1 - randomUniform(seed, RANDOM_EXPOSURE, step, first, second)) * meanDose);
+				}
+				dose += (float)(threshold * (1.0 / 9007199254740992.0) * stepSeconds);
+				if (dose < infectingDose) {
+					exposures.store(key, dose, infectingDose, thread);
+					return;
+				}
+			}
+			else if ((randomBits(seed, RANDOM_INFECTION, step, first, second) >> 11) >= threshold) {
+				return;
+			}
+			catchInfection(target, targetState, changes, thread);
+		};
+
+		if (settings.broadPhase == BROADPHASE_GRID) {
+			if (PERIODIC) {
+				grid.forEachInRangeWrapped(positionX, positionY, range, transmit);
+			}
+			else {
+				grid.forEachInRange(positionX, positionY, range, transmit);
+			}
+		}
+		else if (settings.broadPhase == BROADPHASE_VERLET) {
+			neighborList.forEachNeighbor(source, transmit);
+		}
+		else if (settings.broadPhase == BROADPHASE_SWEEP) {
+			sweep.forEachInRange(source, range, transmit);
+		}
+		else if (settings.broadPhase == BROADPHASE_HIERARCHICAL) {
+			if (transmissionRadius > 0) {
+				hierarchy.forEachInRange(positionX, positionY, transmissionRadius, transmit);
+			}
+			else {
+				hierarchy.forEachOverlapping(positionX, positionY, sourceRadius, transmit);
+			}
+		}
+		else {
+			for (size_t target = 0;target < moving;target++) {
+				transmit(target);
+			}
+		}
+
+		if (stationary) {
+			auto transmitStationary = [&](size_t target) {
+				transmit(moving + target);
+			};
+			if (PERIODIC) {
+				stationaryGrid.forEachInRangeWrapped(positionX, positionY, range, transmitStationary);
+			}
+			else {
+				stationaryGrid.forEachInRange(positionX, positionY, range, transmitStationary);
+			}
+		}
+	}
+
+	for (int i = 0;i < NUM_AGENT_STATES;i++) {
+		threadStateChanges[thread * STATE_COUNT_STRIDE + i] += changes[i];
+	}
+}
@@ -0,0 +1,395 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "AirborneField.h"
+#include "ContactMatrix.h"
+#include "DensityHistogram.h"
+#include "DensityMap.h"
+#include "DistanceField.h"
+#include "ExposureMap.h"
+#include "HierarchicalGrid.h"
+#include "MortonOrder.h"
+#include "NeighborList.h"
+#include "ObstacleMap.h"
+#include "SpatialGrid.h"
+#include "SweepAndPrune.h"
+#include "ThreadPool.h"
+#include "TimerWheel.h"
+
+//Compile-time replacements shared by the window and the headless runner. They are the defaults of SimulationSettings.
+#define PI 3.14159265358979323846
+#define NUM_CIRCLES 30
+#define CIRCLE_RADIUS 0.05
+#define RADIUS_RATIO 1.0
+#define CIRCLE_SPEED 0.01
+#define BOX_SIZE 1.0
+#define FRAMERATE 60
+#define INFECTION_CHANCE 1.0
+#define AVG_RECOVERY 5.0
+#define RECOVERY_VARIATION 0.5
+#define AVG_LATENCY 0.0
+#define AVG_PRESYMPTOMATIC 0.0
+#define ASYMPTOMATIC_FRACTION 0.0
+#define INFECTIOUS_DOSE 0.0
+#define AIRBORNE_EMISSION 0.0
+#define AIRBORNE_INTAKE 0.01
+#define AIRBORNE_DIFFUSION 0.01
+#define AIRBORNE_DECAY 0.5
+#define AIRBORNE_RESOLUTION 64
+#define IMMUNITY true
+#define TRANSMISSION_RADIUS 0.0
+#define VERLET_SKIN 0.1
+#define REORDER_INTERVAL 100
+#define STATIONARY_FRACTION 0.0
+
+//The half-height of the corridor, and the spread of the clusters, the circles can be placed in, as a fraction of the box
+#define PLACEMENT_SPREAD 0.05
+#define PLACEMENT_CLUSTERS 8
+
+//How many cells of the wall distance field fit across the smallest circle, so the walls are smooth at the scale of the circles
+#define WALL_FIELD_CELLS_PER_RADIUS 2
+
+//Entries of the table the transmission kernel is looked up in, evenly spaced in squared distance
+#define TRANSMISSION_KERNEL_SIZE 256
+
+//Entries of the per-thread state changes between the changes of two threads, so every thread's changes are on a cache line of their own
+#define STATE_COUNT_STRIDE 8
+
+//What each agent currently is. Stored as one byte per agent.
+//An infected agent goes through EXPOSED (not infectious yet) if there is a latent period, then either ASYMPTOMATIC, or PRESYMPTOMATIC (infectious without symptoms yet) if there is a presymptomatic period, and INFECTED (symptomatic), before it becomes RECOVERED.
+//The stages that can be turned off come last, so the three states every model has keep their values.
+enum AgentState
+{
+	SUSCEPTIBLE,
+	INFECTED,
+	RECOVERED,
+	EXPOSED,
+	PRESYMPTOMATIC,
+	ASYMPTOMATIC,
+	NUM_AGENT_STATES
+};
+
+//How many agents are infected in any stage, from the counts of every state
+inline unsigned long long activeInfections(const unsigned long long* counts)
+{
+	return counts[EXPOSED] + counts[PRESYMPTOMATIC] + counts[ASYMPTOMATIC] + counts[INFECTED];
+}
+
+//How long each stage of an infection lasts. Every distribution has the mean of its stage: avgLatency, avgPresymptomatic or avgRecovery seconds.
+enum RecoveryDistribution
+{
+	//The same chance of recovering in every step, as if a coin were flipped each frame
+	RECOVERY_GEOMETRIC,
+	//Gamma distributed, with a standard deviation of recoveryVariation times the mean
+	RECOVERY_GAMMA,
+	//Lognormally distributed, with a standard deviation of recoveryVariation times the mean
+	RECOVERY_LOGNORMAL
+};
+
+//How the chance of passing on the infection falls off with the distance between two agents, from infectionChance at distance 0 down to the reach
+enum TransmissionKernel
+{
+	KERNEL_FLAT,
+	//Falls off linearly with the distance
+	KERNEL_LINEAR,
+	//A Gaussian with a standard deviation of half the reach
+	KERNEL_GAUSSIAN
+};
+
+//How the collision step finds the pairs of circles that might overlap
+enum BroadPhase
+{
+	//Bucket the circles into a uniform grid and only compare neighboring cells
+	BROADPHASE_GRID,
+	//Compare every circle with every other one. Only useful as a reference for small populations.
+	BROADPHASE_PAIRWISE,
+	//Keep a list of the circles near each circle, and only rebuild the lists once a circle has moved more than half of verletSkin
+	BROADPHASE_VERLET,
+	//Sort the circles along the axis they are more spread out on, and only compare the ones that are close along it. Suits crowds strung out along a corridor, where most grid cells would be empty.
+	BROADPHASE_SWEEP,
+	//Bucket the circles into a stack of grids, one per octave of radius. Suits populations whose radii are very different, where the cells of a single grid would have to fit the biggest circle.
+	BROADPHASE_HIERARCHICAL
+};
+
+//Where createCircles() puts the circles
+enum Placement
+{
+	//Anywhere in the box
+	PLACEMENT_UNIFORM,
+	//In a horizontal band through the middle of the box, PLACEMENT_SPREAD of the box high on either side
+	PLACEMENT_CORRIDOR,
+	//Around PLACEMENT_CLUSTERS random points, normally distributed with a standard deviation of PLACEMENT_SPREAD of the box
+	PLACEMENT_CLUSTERED,
+	//Wherever densityMap is bright
+	PLACEMENT_DENSITY_MAP
+};
+
+struct SimulationSettings
+{
+	int numCircles;
+	//The radius of the smallest circles
+	double circleRadius;
+	//How many times bigger than circleRadius the biggest circles are. The radii are drawn so that every octave of radius covers the same total area, so there are four times fewer circles in each octave than in the one below it. 1 makes every circle the same size.
+	double radiusRatio;
+	double circleSpeed;
+	//The circles move inside the box [-boxSize, boxSize]^2
+	double boxSize;
+	//Make the box wrap around (a torus): circles leaving through one side come back in through the other, and circles near opposite sides are neighbors. Only the grid and pairwise broad phases support it.
+	bool periodic;
+	int framerate;
+	//The chance of passing it on at distance 0, unless there are groups
+	double infectionChance;
+	//Groups of agents that pass it on to each other with their own chances instead of infectionChance. Empty puts everyone in one group.
+	ContactMatrix contacts;
+	//How close an infected agent's center has to come to another one's to pass it on. 0 means the circles have to touch.
+	double transmissionRadius;
+	TransmissionKernel transmissionKernel;
+	//Pass it on once a pair has been within reach for long enough, rather than with a chance every step: the pair builds up the chance of the step (from infectionChance or the groups, and the kernel) times the length of the step as its dose, and the infection happens once the dose reaches a threshold drawn for the pair from an exponential distribution with this mean, in seconds.
+	//The dose is dropped once the pair is out of reach again. 0 uses a chance every step instead.
+	double infectiousDose;
+	//How many quanta (infectious doses) an infectious agent breathes out into the air per second. The air carries them across the box on a grid of airborneResolution cells a side, see AirborneField, and every susceptible agent can catch it from the cell it is in, however far away the source is. 0 leaves the air out.
+	double airborneEmission;
+	//How much area of air an agent breathes in per second
+	double airborneIntake;
+	//How fast the air spreads, as a diffusion coefficient in units of area per second
+	double airborneDiffusion;
+	//How fast the air is cleared out by ventilation and settling: what is in it falls by a factor of e every 1 / airborneDecay seconds
+	double airborneDecay;
+	int airborneResolution;
+	//How long a newly infected agent is exposed, infected but not infectious yet, on average in seconds. 0 makes it infectious straight away.
+	double avgLatency;
+	//The chance that an infected agent never shows symptoms. It is infectious for avgRecovery seconds on average, like a symptomatic one.
+	double asymptomaticFraction;
+	//How long an agent that will show symptoms is infectious before it does, on average in seconds. 0 makes it symptomatic straight away.
+	double avgPresymptomatic;
+	//How long a symptomatic agent stays infected, on average in seconds
+	double avgRecovery;
+	RecoveryDistribution recoveryDistribution;
+	double recoveryVariation;
+	bool immunity;
+	//Threads used for each step, counting the thread that calls circleMotion(). 0 uses every hardware thread.
+	int numThreads;
+	BroadPhase broadPhase;
+	Placement placement;
+	DensityMap densityMap;
+	//Walls and solid obstacles the circles bounce off, besides the sides of the box
+	ObstacleMap obstacles;
+	//The fraction of the agents that stay where they are placed, e.g. the ones keeping to social distancing. Only the grid, pairwise and hierarchical broad phases support them.
+	double stationaryFraction;
+	//Place the circles so that none of them overlap (Poisson-disk sampling). Otherwise every circle is placed on its own, and the first collision pass pushes apart the ones that overlap as well as it can.
+	bool spacedPlacement;
+	//How much further than the collision and transmission reach the Verlet lists look. A wider skin means rebuilding less often but longer lists.
+	double verletSkin;
+	//Every how many steps the agents are sorted along a Morton curve, so neighbors in space stay neighbors in memory. 0 never sorts them.
+	int reorderInterval;
+	unsigned long long seed;
+
+	SimulationSettings();
+};
+
+//The agents, stored as one array per attribute (structure of arrays), so each pass over the population only streams through the attributes it needs
+struct Population
+{
+	std::vector<double> x;
+	std::vector<double> y;
+	std::vector<double> vx;
+	std::vector<double> vy;
+	std::vector<double> radius;
+	std::vector<unsigned char> state;
+
+	//Which agent this is, for everything that has to follow an agent when the agents get reordered: the random numbers it draws, its stage changes, and the infectious list. Agents start out at the index of their id.
+	std::vector<unsigned int> id;
+
+	//Which group of contacts the agent is in
+	std::vector<unsigned char> group;
+
+	//Whether the agent moves. The stationary agents are always kept after all the moving ones, see Simulation::getMovingAgents().
+	std::vector<unsigned char> mobile;
+
+	size_t size() const
+	{
+		return x.size();
+	}
+};
+
+//What the renderer needs to draw one circle. Laid out to be read directly as a per-instance vertex attribute.
+struct CircleInstance
+{
+	float x;
+	float y;
+	float radius;
+	unsigned int state;
+};
+
+class Simulation
+{
+	SimulationSettings settings;
+	ThreadPool pool;
+	SpatialGrid grid;
+	NeighborList neighborList;
+	SweepAndPrune sweep;
+	HierarchicalGrid hierarchy;
+	//The stationary agents, which only has to be built again when they are reordered
+	SpatialGrid stationaryGrid;
+	bool stationaryGridExpired;
+	DistanceField walls;
+	MortonOrder morton;
+	DensityHistogram density;
+
+	//The index of every agent id, and room to reorder the attributes that aren't double buffered
+	std::vector<unsigned int> agentIndex;
+	std::vector<unsigned int> reorderIndices;
+	std::vector<double> reorderRadius;
+	std::vector<unsigned int> reorderIds;
+	std::vector<unsigned char> reorderMobile;
+	std::vector<unsigned char> reorderGroups;
+	std::vector<unsigned int> reorderPartition;
+
+	//Set by the collision step when a circle has moved too far for the neighbor lists
+	std::atomic<bool> neighborListExpired;
+	unsigned long long neighborListBuilds;
+
+	//How many agents didn't fit without overlapping when they were placed
+	size_t crowdedAgents;
+
+	//The collision step reads the positions, velocities and states of the current step and writes the next ones, so every agent can be processed independently and in parallel
+	Population current;
+	Population next;
+	double maxRadius;
+	unsigned long long step;
+
+	//The agents in [0, movingCount) move, the rest are stationary. Only the moving ones go through the collision pass and the broad phase, and they look up the stationary ones in stationaryGrid, so two stationary agents are never compared.
+	size_t movingCount;
+
+	//How many agents are in each state. Only the infections and the stage changes of a step change them: every thread counts the infections it causes into its own entries of threadStateChanges, which are added on once the step is done, and the stage changes are counted as they come due.
+	unsigned long long stateCounts[NUM_AGENT_STATES];
+	std::vector<long long> threadStateChanges;
+
+	//When every infected agent moves on to its next stage, by id. The step a stage starts in draws how long it lasts, and the agents each thread infects are scheduled once the step is done, so the stages cost nothing until they end.
+	TimerWheel stageChanges;
+	std::vector<std::vector<unsigned int> > threadInfections;
+	std::vector<unsigned int> changingStage;
+
+	//The ids of the infectious agents in no particular order, and where each id is in that list. Only these have to look for someone to infect, so the infection pass costs nothing once nobody is infectious.
+	std::vector<unsigned int> infectedAgents;
+	std::vector<unsigned int> infectedSlot;
+
+	//The step (plus one) each agent was last infected in, by index, as it only matters within a step. Several infected agents can reach the same one in a step, and only the one that claims it first counts it.
+	std::unique_ptr<std::atomic<unsigned long long>[]> infectionClaims;
+
+	//The chance of an infection from an agent of group s to one of group t, for a squared distance of (i + 0.5) / TRANSMISSION_KERNEL_SIZE of the squared reach, at ((s * groupCount + t) * TRANSMISSION_KERNEL_SIZE + i).
+	//It is stored as the threshold the top 53 bits of a random number have to stay under, so the infection pass needs neither a square root nor an exp(), nor a conversion to double.
+	std::vector<unsigned long long> transmissionThreshold;
+	int groupCount;
+
+	//The dose every pair of an infectious and a susceptible agent within reach of each other has built up, see infectiousDose
+	ExposureMap exposures;
+
+	//The quanta in the air, see airborneEmission
+	AirborneField airborne;
+
+	//When set, the collision step also writes every circle's new instance data here
+	CircleInstance* instanceOutput;
+
+	void buildBroadPhase();
+	void reorder();
+	template<bool MOVE>
+	void collide();
+	template<bool MOVE, bool PERIODIC>
+	void collideRange(size_t begin, size_t end);
+	void copyStationaryRange(size_t begin, size_t end);
+	void infect();
+	void breathe();
+	void catchInfection(size_t target, unsigned char targetState, long long* changes, int thread);
+	template<bool PERIODIC, bool DOSE>
+	void infectRange(size_t begin, size_t end, int thread);
+	void swapBuffers();
+	void mergeStateCounts();
+	void advanceStages();
+	void scheduleInfections();
+	unsigned char onsetState(unsigned int id, unsigned long long onsetStep) const;
+	double stageSeconds(unsigned char state) const;
+	unsigned long long stageSteps(unsigned int id, unsigned long long startStep, double seconds) const;
+
+public:
+	Simulation(const SimulationSettings& settings);
+
+	//Places the circles randomly inside the box, pushes apart the ones that overlap, and infects the first one
+	void createCircles();
+
+	//Advances the simulation by one frame: collisions, infections and stage changes, then movement
+	void circleMotion();
+
+	//Resolves the overlaps and infections of the current positions without moving the circles
+	void circleCollision();
+
+	//Makes the following steps write the instance data of every circle into instances as they go, e.g. straight into a mapped GPU buffer. NULL turns it off.
+	void setInstanceOutput(CircleInstance* instances)
+	{
+		instanceOutput = instances;
+	}
+
+	//Writes the instance data of the current positions, for frames where the simulation doesn't step
+	void writeInstances(CircleInstance* instances);
+
+	//Counts the circles of each state in a resolution x resolution grid over the box, see DensityHistogram. Returns the most circles in a single cell.
+	unsigned int densityHistogram(int resolution, std::vector<unsigned int>& counts);
+
+	//The agents can be reordered by a step, see reorderInterval. Population::id tells which agent is where.
+	const Population& getPopulation() const
+	{
+		return current;
+	}
+
+	const SimulationSettings& getSettings() const
+	{
+		return settings;
+	}
+
+	unsigned long long getStep() const
+	{
+		return step;
+	}
+
+	//The number of agents in each state, indexed by AgentState. Kept up to date by every step, so reading it doesn't touch the agents.
+	const unsigned long long* getStateCounts() const
+	{
+		return stateCounts;
+	}
+
+	//How many agents createCircles() couldn't fit without overlapping others, and placed anywhere instead. Always 0 without spacedPlacement.
+	size_t getCrowdedAgents() const
+	{
+		return crowdedAgents;
+	}
+
+	//How many agents move. They are the first ones of the population, and the stationary ones come after them.
+	size_t getMovingAgents() const
+	{
+		return movingCount;
+	}
+
+	//How many pairs of agents were building up a dose in the last step, see infectiousDose
+	size_t getExposedPairs() const
+	{
+		return exposures.size();
+	}
+
+	//The quanta in the air over the box, only kept up to date with airborneEmission
+	const AirborneField& getAirborne() const
+	{
+		return airborne;
+	}
+
+	//How often the Verlet lists have been built since createCircles()
+	unsigned long long getNeighborListBuilds() const
+	{
+		return neighborListBuilds;
+	}
+
+	int getNumThreads() const
+	{
+		return pool.size();
+	}
+};
@@ -0,0 +1,132 @@
+#include "SimulationThread.h"
+#include "Profiler.h"
+
+#include <chrono>
+
+using namespace std;
+
+SimulationThread::SimulationThread(Simulation& simulation, TripleBuffer<Snapshot>& snapshots) : simulation(simulation), snapshots(snapshots), running(false), stopping(false), withDensity(false), republish(false)
+{
+}
+
+SimulationThread::~SimulationThread()
+{
+	stop();
+}
+
+void SimulationThread::start()
+{
+	if (!thread.joinable()) {
+		stopping = false;
+		thread = std::thread(&SimulationThread::loop, this);
+	}
+}
+
+void SimulationThread::stop()
+{
+	if (!thread.joinable()) {
+		return;
+	}
+	{
+		lock_guard<mutex> guard(lock);
+		stopping = true;
+	}
+	wake.notify_one();
+	thread.join();
+}
+
+void SimulationThread::setRunning(bool run)
+{
+	{
+		lock_guard<mutex> guard(lock);
+		running = run;
+	}
+	wake.notify_one();
+}
+
+void SimulationThread::setDensity(bool density)
+{
+	if (withDensity == density) {
+		return;
+	}
+	{
+		lock_guard<mutex> guard(lock);
+		withDensity = density;
+		republish = true;
+	}
+	wake.notify_one();
+}
+
+void SimulationThread::fillSnapshot(Snapshot& snapshot)
+{
+	snapshot.count = simulation.getPopulation().size();
+	snapshot.step = simulation.getStep();
+	for (int i = 0;i < NUM_AGENT_STATES;i++) {
+		snapshot.counts[i] = simulation.getStateCounts()[i];
+	}
+	{
+		TRACE_SCOPE("curve");
+		history.plot(snapshot.curve, CURVE_POINTS);
+	}
+	snapshot.hasDensity = withDensity;
+	if (snapshot.hasDensity) {
+		TRACE_SCOPE("density");
+		snapshot.densityPeak = simulation.densityHistogram(DENSITY_RESOLUTION, snapshot.density);
+	}
+}
+
+void SimulationThread::loop()
+{
+	TraceRecorder::setThreadName("simulation");
+
+	//Publish where the circles start, so there is something to draw before the first step
+	history.clear();
+	history.add(simulation.getStep(), simulation.getStateCounts());
+	Snapshot& first = snapshots.writeBuffer();
+	simulation.writeInstances(first.instances);
+	fillSnapshot(first);
+	snapshots.publish();
+
+	chrono::steady_clock::duration period = chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(1.0 / simulation.getSettings().framerate));
+	chrono::steady_clock::time_point nextStep = chrono::steady_clock::now();
+
+	while (!stopping) {
+		if (!running) {
+			unique_lock<mutex> guard(lock);
+			wake.wait(guard, [&]() { return running || stopping || republish; });
+			nextStep = chrono::steady_clock::now();
+			if (!running && republish) {
+				republish = false;
+				guard.unlock();
+				Snapshot& snapshot = snapshots.writeBuffer();
+				simulation.writeInstances(snapshot.instances);
+				fillSnapshot(snapshot);
+				snapshots.publish();
+			}
+			continue;
+		}
+		republish = false;
+
+		{
+			//The step writes the new instance data straight into the slot it is about to publish
+			PROFILE_PHASE(PHASE_STEP);
+			Snapshot& snapshot = snapshots.writeBuffer();
+			simulation.setInstanceOutput(snapshot.instances);
+			simulation.circleMotion();
+			simulation.setInstanceOutput(NULL);
+			history.add(simulation.getStep(), simulation.getStateCounts());
+			fillSnapshot(snapshot);
+		}
+		snapshots.publish();
+
+		//One step per frame, like before. A step that took longer than a frame is followed straight away by the next one, without trying to catch up.
+		nextStep += period;
+		chrono::steady_clock::time_point now = chrono::steady_clock::now();
+		if (nextStep < now) {
+			nextStep = now;
+		}
+		else {
+			this_thread::sleep_until(nextStep);
+		}
+	}
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "EpidemicHistory.h"
+#include "Simulation.h"
+#include "TripleBuffer.h"
+
+//One published state of the population: the instance data of every circle after a step
+struct Snapshot
+{
+	//Which region of the instance buffer the circles were written to, and where that is in memory
+	int region;
+	CircleInstance* instances;
+	size_t count;
+	unsigned long long step;
+
+	//How many circles are in each state, and how that went over the whole run
+	unsigned long long counts[NUM_AGENT_STATES];
+	EpidemicCurve curve;
+
+	//The circles of each state per cell of a DENSITY_RESOLUTION grid, only filled in while the density is asked for
+	bool hasDensity;
+	std::vector<unsigned int> density;
+	unsigned int densityPeak;
+};
+
+//Steps a simulation on its own thread, at most framerate steps per second, and publishes every step through a triple buffer.
+//The renderer draws whichever snapshot is newest when it starts a frame, so a slow step never drops frames and a slow frame never slows the simulation down.
+class SimulationThread
+{
+	Simulation& simulation;
+	TripleBuffer<Snapshot>& snapshots;
+	EpidemicHistory history;
+	std::thread thread;
+	std::atomic<bool> running;
+	std::atomic<bool> stopping;
+	std::atomic<bool> withDensity;
+
+	//Set when the snapshot has to be published again while paused, because it should hold something else now
+	std::atomic<bool> republish;
+
+	//Only used to sleep while paused, never to hand over snapshots
+	std::mutex lock;
+	std::condition_variable wake;
+
+	void loop();
+	void fillSnapshot(Snapshot& snapshot);
+
+public:
+	//The instances of every slot of snapshots must point at room for the whole population
+	SimulationThread(Simulation& simulation, TripleBuffer<Snapshot>& snapshots);
+	~SimulationThread();
+
+	//Publishes the starting positions, then steps whenever running
+	void start();
+	void stop();
+
+	void setRunning(bool run);
+	bool isRunning() const
+	{
+		return running;
+	}
+
+	//Whether the snapshots also carry the density histogram
+	void setDensity(bool density);
+};
@@ -9,13 +9,21 @@
 //Allows use of vector objects
 #include <vector>
 
-//Gives random number generation
-#include<cstdlib>
-#include <time.h>
 #include <math.h>
 
-//Circle class
-#include "Circle.h"
+//The simulation itself, which doesn't need a window
+#include "Simulation.h"
+
+//Chrome trace recording and timing of the simulation phases
+#include "Profiler.h"
+
+//Draws the circles, streamed to the GPU every frame, or their density
+#include "Renderer.h"
+
+//Runs the simulation next to the rendering, handing over the circles through a triple buffer
+#include "SimulationThread.h"
+
+#include <cstddef>
 
 #include "imgui.h"
 #include "imgui_impl_glfw.h"
@@ -25,60 +33,15 @@
 using namespace std;
 
 //Compile-time replacements:
-#define PI 3.14159265358979323846
 #define WINDOW_WIDTH 800
 #define WINDOW_HEIGHT 600
-#define NUM_CIRCLE_VERTICES 100
-#define NUM_CIRCLES 30
-#define CIRCLE_RADIUS 0.05
-#define CIRCLE_SPEED 0.01
-#define FRAMERATE 60
-#define INFECTION_CHANCE 1.0
-#define AVG_RECOVERY 5.0
-#define IMMUNITY true
+#define TRACE_FILE "covid19contactmodeling-trace.json"
 
 //Tells VS that these will be functions that I will define at some point in the future
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void processInput(GLFWwindow* window);
 void drawInSquareViewport(GLFWwindow* window);
-vector<Circle> generateCircles();
-vector<Circle> createCircles(int amount, int VAO);
-vector<Circle> circleMotion(vector<Circle> circles);
-vector<Circle> circleCollision(vector<Circle> circles);
-void drawCircles(vector<Circle> circles, int shaderProgram);
-
-//Source code for the vertex shader. This program is written for OpenGL and describes how to transform the vertex data to put it on the screen
-const char *vertexShaderSource = "#version 330 core\n"
-"layout (location=0) in vec3 position;\n" //Specifies that the position vector should be put in location 0
-
-//This matrix will hold the scaling and translational data for the drawing of the entire circle
-"uniform mat4 mvMatrix;\n"
-
-//This will hold the rgb color data
-"uniform vec3 color;\n"
-
-"out VS_OUT {\n"
-"	vec4 color;\n"
-"} vs_out;\n"
-
-
-"void main()\n"
-"{\n"
-"	gl_Position=mvMatrix*vec4(position,1.0);\n"
-"	vs_out.color=vec4(color, 1.0);\n"
-"}\0";
-
-//Source code for the fragment shader. This program is also written for OpenGL and describes how to color shapes that we are passing in. It colors everything the same color.
-const char *fragmentShaderSource = "#version 330 core\n"
-    "out vec4 FragColor;\n"
-	"in VS_OUT{\n"
-	"	vec4 color;\n"
-	"} fs_in;\n"
-    "void main()\n"
-    "{\n"
-    "   FragColor = fs_in.color;\n"
-	"}\0";
-
+void plotEpidemicCurve(const EpidemicCurve& curve, bool wholeRun, size_t population);
 
 // Our IMGUI demo code state
 static bool show_demo_window = true;
@@ -155,6 +118,8 @@ int main()
 	//Makes the window the current place to draw stuff. This tells OpenGL where the image data that it is about to render should go.
 	glfwMakeContextCurrent(window);
 
+	//Frames are paced by the display refresh. The simulation keeps its own pace on its own thread.
+	glfwSwapInterval(1);
 
         if (gl3w_init()) {
           return -1;
@@ -173,56 +138,31 @@ int main()
 	//References our program to link OpenGL with the instructions on what to do in the event of a window resize
 	glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
 
-	//Compile and build the vertex shader program
-	unsigned int vertexShader;
-	vertexShader = glCreateShader(GL_VERTEX_SHADER);
-	glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
-	glCompileShader(vertexShader);
-
-	//Check if the vertex shader actually built properly. It would be bad to try to render with it if it doesn't work.
-	int success;
-	char infoLog[512];
-	glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
-	//Print out any error messages
-	if (!success) {
-		glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
-		std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
-	}
-
-	//Compile and build the fragment shader program
-	unsigned int fragmentShader;
-	fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-	glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
-	glCompileShader(fragmentShader);
-
-	//Check if the fragment shader built properly
-	glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
-	//Print any error messages
-	if (!success) {
-		glGetShaderInfoLog(fragmentShader, 512, NULL, infoLog);
-		std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
-	}
-
-	//Now we need to link the two shaders into one program
-	unsigned int shaderProgram;
-	shaderProgram = glCreateProgram();
-	glAttachShader(shaderProgram, vertexShader);
-	glAttachShader(shaderProgram, fragmentShader);
-	glLinkProgram(shaderProgram);
-
-	//Check if the program built properly
-	glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
-	if (!success) {
-		glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
-		std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+	//Build the shaders and meshes of every way the circles can be drawn, then the simulation with its array of circles, and the buffer the circles get streamed through
+	Renderer renderer;
+	renderer.create();
+	SimulationSettings settings;
+	Simulation simulation(settings);
+	simulation.createCircles();
+	InstanceStream instanceStream;
+	instanceStream.create(simulation.getPopulation().size());
+
+	//Every slot of the triple buffer gets its own region of the instance buffer, so the simulation writes its snapshots straight into it
+	TripleBuffer<Snapshot> snapshots;
+	for (int i = 0;i < INSTANCE_REGIONS;i++) {
+		Snapshot& snapshot = snapshots.slot(i);
+		snapshot.region = i;
+		snapshot.instances = instanceStream.getRegion(i);
+		snapshot.count = 0;
+		snapshot.step = 0;
+		snapshot.hasDensity = false;
+		snapshot.densityPeak = 0;
+		for (int state = 0;state < NUM_AGENT_STATES;state++) {
+			snapshot.counts[state] = 0;
+		}
 	}
-
-	//Since the shaders have been built into a program, we can now delete them
-	glDeleteShader(vertexShader);
-	glDeleteShader(fragmentShader);
-
-	//Generate array of circles
-	vector<Circle> circles = generateCircles();
+	SimulationThread simulationThread(simulation, snapshots);
+	simulationThread.start();
 
 
 
@@ -244,47 +184,68 @@ int main()
           ImGui_ImplOpenGL3_Init("#version 330");
         }
 
-	//Saves the time for framerate comparisons
-	double time_at_beginning_of_previous_frame = glfwGetTime();
+	//Names this thread's row in any trace that gets recorded
+	TraceRecorder::setThreadName("main");
+	bool recordingTrace = false;
 
 
 
 
         bool simulationRunning = false;
         bool settingUpSim = true;
+        int renderMode = RENDER_MESH;
+        bool plotWholeRun = true;
+        bool instancesUploaded = false;
+        bool densityUploaded = false;
 	//Event loop. This contains what the program should do every frame.
 	while (!glfwWindowShouldClose(window))
 	{
-          if(simulationRunning)
-            {
-              //Checks to see if enough time has passed to bother rendering another frame
-              if (glfwGetTime() < time_at_beginning_of_previous_frame + 1.0 / FRAMERATE)
-		{
-                  continue;
-		}
-              //Saves the current time to reference on the next iterations of the loop
-              time_at_beginning_of_previous_frame = glfwGetTime();
-
-              //Processes any input that has happened since the last frame
-              processInput(window);
+          //Processes any input that has happened since the last frame
+          processInput(window);
 
-              //Processes the movement of the circle
-              circles=circleMotion(circles);
+          //Only the snapshots shown as a heatmap need the density histogram
+          simulationThread.setDensity(renderMode == RENDER_DENSITY);
 
+          //Picks up the newest snapshot, if the simulation published one since the last frame. The one drawn until now goes back to the simulation, so the GPU has to be done reading it first.
+          if (snapshots.hasUpdate())
+            {
+              instanceStream.waitForRegion(snapshots.readBuffer().region);
+              snapshots.update();
+              instancesUploaded = false;
+              densityUploaded = false;
             }
+          const Snapshot& snapshot = snapshots.readBuffer();
+
           //Clears and resizes the window appropriately
           drawInSquareViewport(window);
           if(!settingUpSim)
             {
+              TRACE_SCOPE("draw");
 
-              //Tells OpenGL to use the shaders that we custom made
-              glUseProgram(shaderProgram);
-
-              drawCircles(circles,shaderProgram);
+              //Whatever the current view needs is only uploaded once per snapshot
+              if (renderMode == RENDER_DENSITY)
+                {
+                  if (!densityUploaded && snapshot.hasDensity)
+                    {
+                      renderer.uploadDensity(snapshot.density, snapshot.densityPeak);
+                      densityUploaded = true;
+                    }
+                  renderer.drawDensity();
+                }
+              else
+                {
+                  if (!instancesUploaded)
+                    {
+                      instanceStream.upload(snapshot.region, snapshot.count);
+                      instancesUploaded = true;
+                    }
+                  renderer.drawCircles((RenderMode)renderMode,instanceStream,snapshot.region,snapshot.count,settings.boxSize);
+                }
             }
 
           //imgui
           {
+            TRACE_SCOPE("gui");
 
             // Start the Dear ImGui frame
             ImGui_ImplOpenGL3_NewFrame();
@@ -301,12 +262,51 @@ int main()
               if (ImGui::Button(simulationRunning ? "Pause" : "Start"))
                 {
                   simulationRunning = !simulationRunning;
+                  simulationThread.setRunning(simulationRunning);
                   if(settingUpSim)
                     settingUpSim = false;
                 }
+              ImGui::SameLine();
+              ImGui::Text("step %llu, %.0f FPS", snapshot.step, ImGui::GetIO().Framerate);
+
+              ImGui::RadioButton("Mesh", &renderMode, RENDER_MESH);
+              ImGui::SameLine();
+              ImGui::RadioButton("Signed distance", &renderMode, RENDER_SDF);
+              ImGui::SameLine();
+              ImGui::RadioButton("Density", &renderMode, RENDER_DENSITY);
+
+              // Records the phases of every frame until unchecked, then writes them out for chrome://tracing
+              if (ImGui::Checkbox("Record trace", &recordingTrace))
+                {
+                  if (recordingTrace)
+                    TraceRecorder::start();
+                  else if (!TraceRecorder::stop(TRACE_FILE))
+                    std::cout << "Failed to write " << TRACE_FILE << std::endl;
+                }
+              if (recordingTrace)
+                {
+                  ImGui::SameLine();
+                  ImGui::Text("writes %s", TRACE_FILE);
+                }
               ImGui::End();
             }
 
+            // The number of circles in each state, over the whole run or the latest steps
+            if (!settingUpSim)
+              {
+                ImGui::Begin("Epidemic curve");
+                ImGui::Text("susceptible %llu, infected %llu, recovered %llu", snapshot.counts[SUSCEPTIBLE], snapshot.counts[INFECTED], snapshot.counts[RECOVERED]);
+                if (settings.avgLatency > 0 || settings.avgPresymptomatic > 0 || settings.asymptomaticFraction > 0)
+                  ImGui::Text("exposed %llu, presymptomatic %llu, asymptomatic %llu", snapshot.counts[EXPOSED], snapshot.counts[PRESYMPTOMATIC], snapshot.counts[ASYMPTOMATIC]);
+                if (ImGui::RadioButton("Whole run", plotWholeRun))
+                  plotWholeRun = true;
+                ImGui::SameLine();
+                if (ImGui::RadioButton("Latest steps", !plotWholeRun))
+                  plotWholeRun = false;
+                plotEpidemicCurve(snapshot.curve, plotWholeRun, snapshot.count);
+                ImGui::End();
+              }
+
             // Rendering
             ImGui::Render();
             ImGuiIO& io = ImGui::GetIO();
@@ -319,6 +319,16 @@ int main()
           glfwPollEvents();
 	}
 
+        // The simulation may still be writing into the instance buffer
+        simulationThread.stop();
+
+        // Don't lose a trace that was still recording when the window closed
+        if (recordingTrace)
+          TraceRecorder::stop(TRACE_FILE);
+
+        instanceStream.destroy();
+        renderer.destroy();
+
         // Cleanup
         ImGui_ImplOpenGL3_Shutdown();
         ImGui_ImplGlfw_Shutdown();
@@ -331,7 +341,6 @@ int main()
 	return 0;
 }
 
-
 //Tells OpenGL what to do in the event of a window resize
 void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
@@ -383,284 +392,35 @@ void drawInSquareViewport(GLFWwindow *window)
 
 }
 
-vector<Circle> generateCircles()
-{
-	//Defines the vertex data that I'd like to use using vector objects
-	vector<double> circle((NUM_CIRCLE_VERTICES + 2) * 3);
-	//The center is (0,0,0) since I'll use the vertex shader to define translations
-
-	//The angle as measured from (0,1,0) clockwise
-	double angle;
-
-	//Makes a ring of vertices to draw with TRIANGLEFAN
-	for (int i = 1;i < NUM_CIRCLE_VERTICES + 2;i++) {
-		angle = (i - 1) * (2 * PI) / NUM_CIRCLE_VERTICES;
-		circle[3 * i] = sin(angle);
-		circle[(3 * i) + 1] = cos(angle);
-	}
-
-
-	//Create a spot in memory for a Vertex Array Object. This will bind together all the calls necessary to send our data to the GPU and interpret it, so that it's easier to call later in the program
-	unsigned int VAO;
-
-	glGenVertexArrays(1, &VAO);
-
-	//Creates a spot in memory for a handle to the Vertex Buffer Object
-	unsigned int VBO;
-
-	//Creates the Vertex Buffer Object and stores the handle in the spot in memory that we specify
-	glGenBuffers(1, &VBO);
-
-	//Sets the Vertex Array Object, so that further calls describing the buffer and interpretation are stored within that instance.
-	glBindVertexArray(VAO);
-
-	//Binds the GL array buffer to the buffer object that we just created
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
-
-	//Sends the vertex data to the data buffer and tells it that we won't be changing this data often (which affects how the graphics card stores the data)
-	glBufferData(GL_ARRAY_BUFFER, circle.size() * sizeof(double), circle.data(), GL_STATIC_DRAW);
-
-	//Defines how to process the data we sent in
-	glVertexAttribPointer(0, 3, GL_DOUBLE, GL_FALSE, 3 * sizeof(double), (void*)0);
-	glEnableVertexAttribArray(0);
 
-	//Now that we've finished making all of those definitions, tell OpenGL to stop writing things to those objects so that future statements don't accidentally modify them.
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindVertexArray(0);
-
-	vector<Circle> result=createCircles(NUM_CIRCLES, VAO);
-
-	return result;
-}
-
-vector<Circle> createCircles(int amount, int VAO)
-{
-	vector<Circle> result(amount);
-	vector<double> position(2);
-	vector<double> velocity(2);
-	vector<float> color(3);
-	double angle;
-	double max=RAND_MAX;
-
-	srand(time(NULL));
-
-	//Make the uninfected color blue
-	color[2] = 1.0;
-
-	for (int i = 0;i < result.size();i++) {
-
-		//Calculate random position
-		position[0] = (rand() / max) * 2 - 1;
-		position[1] = (rand() / max) * 2 - 1;
-
-		//Create circle object
-		result[i] = Circle(position, CIRCLE_RADIUS, VAO);
-
-		//Calculate random velocity angle
-		angle = (rand() / max) * 2 * PI;
-
-		//Calculate Cartesian components of velocity
-		velocity[0] = cos(angle);
-		velocity[1] = sin(angle);
-
-		//Set velocity result
-		result[i].setVelocity(velocity);
-
-		//Set color to be uninfected;
-		result[i].setColor(color);
-	}
-
-	//Check for circle overlap before the program starts
-	result = circleCollision(result);
-
-	color[2] = 0.0;
-	color[0] = 1.0;
-
-	//Start an infection. Note that I've done this after the collision detection has already run once, so that any circles that were initially overlapping don't infect each other
-	result[0].setColor(color);
-
-	return result;
-}
-
-vector<Circle> circleMotion(vector<Circle> circles)
-{
-	circles=circleCollision(circles);
-
-	vector<double> position;
-	vector<double> velocity;
-
-	for (int circle = 0;circle < circles.size();circle++) {
-		position = circles[circle].getPosition();
-		velocity = circles[circle].getVelocity();
-		position[0] = position[0] + velocity[0]*CIRCLE_SPEED;
-		position[1] = position[1] + velocity[1]*CIRCLE_SPEED;
-
-		circles[circle].setPosition(position);
-	}
-
-	return circles;
-}
-
-vector<Circle> circleCollision(vector<Circle> circles)
+//Draws one line per state, with the counts scaled to the population and the steps to the width of the plot
+void plotEpidemicCurve(const EpidemicCurve& curve, bool wholeRun, size_t population)
 {
-	vector<double> position(2);
-	vector<double> distance(2);
-	vector<double> velocity(2);
-	vector<double> other_velocity(2);
-	vector<float> red(3);
-	vector<float> green(3);
-	double radius;
-	double overlap;
-	double dot;
-	double magnitude;
-
-	double max = RAND_MAX;
-
-	red[0] = 1.0;
-	green[1] = 1.0;
-
-	for (int circle = 0;circle < circles.size();circle++) {
-
-		//Poll the current attributes of the circle of interest
-		position = circles[circle].getPosition();
-		velocity = circles[circle].getVelocity();
-		radius = circles[circle].getRadius();
-
-		//Check for collisions between circles. By starting the second loop after the current position of the first loop, I don't check for the same collision twice
-		for (int other_circle = circle+1;other_circle < circles.size();other_circle++) {
-
-			//Calculates vector between the two circles
-			distance[0] = position[0] - circles[other_circle].getPosition()[0];
-			distance[1] = position[1] - circles[other_circle].getPosition()[1];
-
-			//The magnitude of the distance vector
-			magnitude = sqrt(distance[0] * distance[0] + distance[1] * distance[1]);
-
-			//The amount of overlap between the two circles
-			overlap = (circles[circle].getRadius() + circles[other_circle].getRadius())-magnitude;
-
-			//Rounding error is in the 1e-17 spot, so this avoids weird rounding errors that might not shift the circles quite all of the way out of each other
-			if (overlap>1e-16) {
-				//Poll the velocity of the other circle
-				other_velocity = circles[other_circle].getVelocity();
-
-				//Convert the displacement vector to a unit vector
-				distance[0] = distance[0] / magnitude;
-				distance[1] = distance[1] / magnitude;
-
-				//Shift the position to avoid clipping
-				position[0] = position[0] + distance[0] * overlap;
-				position[1] = position[1] + distance[1] * overlap;
-
-				//Compute the dot product between the velocity and the normal vector to the plane of incidence
-				dot = velocity[0] * (-distance[0]) + velocity[1] * (-distance[1]);
-
-				//Adjust the velocity using the reflection formula
-				velocity[0] = velocity[0] - 2 * dot * (-distance[0]);
-				velocity[1] = velocity[1] - 2 * dot * (-distance[1]);
-
-				//Compute the dot product between the other velocity and the normal vector to the plane of incidence
-				dot = other_velocity[0] * distance[0] + other_velocity[1] * distance[1];
-
-				//Adjust the other velocity using the reflection formula
-				other_velocity[0] = other_velocity[0] - 2 * dot * distance[0];
-				other_velocity[1] = other_velocity[1] - 2 * dot * distance[1];
-
-				//Set the velocity for the other circle
-				circles[other_circle].setVelocity(other_velocity);
-
-				//Check for infection transmission
-				if ((circles[circle].getColor()[0] + circles[other_circle].getColor()[0] == 1.0)) {
-					if (rand() / max < INFECTION_CHANCE) {
-						if (IMMUNITY) {
-							//No chance of reinfection
-							if (circles[circle].getColor() != green) {
-								circles[circle].setColor(red);
-							}
-							if (circles[other_circle].getColor() != green) {
-								circles[other_circle].setColor(red);
-							}
-						}
-						else {
-							circles[circle].setColor(red);
-							circles[other_circle].setColor(red);
-						}
-					}
-				}
-			}
-
-		}
-
-
-		//Checks for collisions between the circles and the sides of the screen
-		//I've intentionally put this last, as I want the circles to stay inside the screen more than I care about them slightly clipping into each other
-		if (position[0] < -1.0 + radius) {
-			position[0] = -1.0 + radius;
-			velocity[0] = -velocity[0];
-		}else if (position[0] > 1.0 - radius) {
-			position[0] = 1.0 - radius;
-			velocity[0] = -velocity[0];
-		}
-
-		if (position[1] < -1.0 + radius) {
-			position[1] = -1.0 + radius;
-			velocity[1] = -velocity[1];
-		}else if (position[1] > 1.0 - radius) {
-			position[1] = 1.0 - radius;
-			velocity[1] = -velocity[1];
-		}
-
-		//Set the circle attributes as calculated
-		circles[circle].setPosition(position);
-		circles[circle].setVelocity(velocity);
-
-		//Check for recovered
-		if ((circles[circle].getColor() == red) && rand() / max < 1 / (AVG_RECOVERY * FRAMERATE)) {
-			circles[circle].setColor(green);
-		}
-
+	const std::vector<float>* steps = wholeRun ? curve.overviewSteps : curve.recentSteps;
+	const std::vector<float>* counts = wholeRun ? curve.overview : curve.recent;
+
+	ImVec2 size(ImGui::GetContentRegionAvail().x, 150.0f);
+	ImVec2 origin = ImGui::GetCursorScreenPos();
+	ImGui::Dummy(size);
+	ImDrawList* drawList = ImGui::GetWindowDrawList();
+	drawList->AddRectFilled(origin, ImVec2(origin.x + size.x, origin.y + size.y), IM_COL32(0, 0, 0, 255));
+	if (steps[0].empty() || population == 0) {
+		return;
 	}
 
-	return circles;
-}
-
-void drawCircles(vector<Circle> circles, int shaderProgram) {
-	//Generate the model matrix for movement around the screen (i.e. the coordinates of where my object origin should reside)
-	//Initialize to the identity matrix to be modified by later object calls
-	float model_matrix[4][4];
-
-	for (int circle = 0;circle < circles.size();circle++) {
-		//Reset model matrix to the identity matrix
-		for (int i = 0;i < 4;i++) {
-			for (int j = 0;j < 4; j++) {
-				if (i == j) {
-					model_matrix[i][j] = 1.0;
-				}
-				else {
-					model_matrix[i][j] = 0.0;
-				}
-			}
-		}
-
-		//Tells OpenGL how to get the data properly transmitted
-		glBindVertexArray(circles[circle].getVertexData());
-
-		//Update the model matrix
-		for (int i = 0;i < 3;i++) {
-			model_matrix[i][i] = (float)circles[circle].getRadius();
+	float first = steps[0].front();
+	float last = steps[0].back();
+	float width = last > first ? last - first : 1.0f;
+
+	//The same colors as the circles
+	const ImU32 colors[NUM_AGENT_STATES] = { IM_COL32(0, 0, 255, 255), IM_COL32(255, 0, 0, 255), IM_COL32(0, 255, 0, 255), IM_COL32(255, 255, 0, 255), IM_COL32(255, 128, 0, 255), IM_COL32(153, 0, 204, 255) };
+	std::vector<ImVec2> points;
+	for (int state = 0;state < NUM_AGENT_STATES;state++) {
+		points.resize(steps[state].size());
+		for (size_t i = 0;i < points.size();i++) {
+			points[i].x = origin.x + (steps[state][i] - first) / width * size.x;
+			points[i].y = origin.y + size.y - counts[state][i] / population * size.y;
 		}
-		model_matrix[3][0] = (float)circles[circle].getPosition()[0];
-		model_matrix[3][1] = (float)circles[circle].getPosition()[1];
-
-		//Pass the Model/View matrix into the shader
-		glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "mvMatrix"), 1, GL_FALSE, *model_matrix);
-
-		//Pass the color from the circle object into the shader
-		glUniform3fv(glGetUniformLocation(shaderProgram, "color"), 1, circles[circle].getColor().data());
-
-
-		//Draw the circle. Yay!
-		glDrawArrays(GL_TRIANGLE_FAN, 0, NUM_CIRCLE_VERTICES + 2);
+		drawList->AddPolyline(points.data(), (int)points.size(), colors[state], false, 1.5f);
 	}
-
 }
@@ -0,0 +1,115 @@
+#include "SpatialGrid.h"
+#include <cmath>
+
+using namespace std;
+
+SpatialGrid::SpatialGrid()
+{
+	cellsPerSide = 1;
+	origin = -1.0;
+	cellSize = 2.0;
+	inverseCellSize = 0.5;
+	cellCountCapacity = 0;
+}
+
+void SpatialGrid::build(const double* x, const double* y, size_t n, double boxSize, double minCellSize, ThreadPool& pool)
+{
+	double extent = 2.0 * boxSize;
+
+	//As many cells as fit, but no more than about two per agent, as empty cells still cost memory and time to skip over
+	double fit = floor(extent / minCellSize);
+	double limit = floor(sqrt(2.0 * n)) + 1.0;
+	cellsPerSide = (int)(fit < limit ? fit : limit);
+	if (cellsPerSide < 1) {
+		cellsPerSide = 1;
+	}
+	origin = -boxSize;
+	cellSize = extent / cellsPerSide;
+	inverseCellSize = 1.0 / cellSize;
+
+	size_t cells = (size_t)cellsPerSide * cellsPerSide;
+	if (cellCountCapacity < cells) {
+		cellCount.reset(new atomic<unsigned int>[cells]);
+		cellCountCapacity = cells;
+	}
+	agentCell.resize(n);
+	cellStart.resize(cells + 1);
+	cellAgents.resize(n);
+
+	atomic<unsigned int>* count = cellCount.get();
+
+	pool.parallelFor(cells, pool.grainFor(cells, 4096), [&](size_t begin, size_t end, int thread) {
+		for (size_t c = begin;c < end;c++) {
+			count[c].store(0, memory_order_relaxed);
+		}
+	});
+
+	//Find every agent's cell and count how many agents each cell gets
+	pool.parallelFor(n, pool.grainFor(n), [&](size_t begin, size_t end, int thread) {
+		for (size_t i = begin;i < end;i++) {
+			unsigned int cell = (unsigned int)(cellCoordinate(y[i]) * cellsPerSide + cellCoordinate(x[i]));
+			agentCell[i] = cell;
+			count[cell].fetch_add(1, memory_order_relaxed);
+		}
+	});
+
+	//Prefix sum of the counts gives where each cell starts. The counters then become the next free slot in each cell.
+	//It is done in blocks: every block is summed in parallel, the block sums are scanned, and then each block is scanned in parallel starting from its offset.
+	size_t blockSize = pool.grainFor(cells, 4096);
+	size_t blocks = (cells + blockSize - 1) / blockSize;
+	blockTotal.resize(blocks + 1);
+
+	pool.parallelFor(blocks, 1, [&](size_t begin, size_t end, int thread) {
+		for (size_t block = begin;block < end;block++) {
+			size_t last = (block + 1) * blockSize < cells ? (block + 1) * blockSize : cells;
+			unsigned int total = 0;
+			for (size_t c = block * blockSize;c < last;c++) {
+				total += count[c].load(memory_order_relaxed);
+			}
+			blockTotal[block] = total;
+		}
+	});
+
+	unsigned int total = 0;
+	for (size_t block = 0;block < blocks;block++) {
+		unsigned int blockCount = blockTotal[block];
+		blockTotal[block] = total;
+		total += blockCount;
+	}
+	cellStart[cells] = total;
+
+	pool.parallelFor(blocks, 1, [&](size_t begin, size_t end, int thread) {
+		for (size_t block = begin;block < end;block++) {
+			size_t last = (block + 1) * blockSize < cells ? (block + 1) * blockSize : cells;
+			unsigned int offset = blockTotal[block];
+			for (size_t c = block * blockSize;c < last;c++) {
+				unsigned int cellTotal = count[c].load(memory_order_relaxed);
+				cellStart[c] = offset;
+				count[c].store(offset, memory_order_relaxed);
+				offset += cellTotal;
+			}
+		}
+	});
+
+	pool.parallelFor(n, pool.grainFor(n), [&](size_t begin, size_t end, int thread) {
+		for (size_t i = begin;i < end;i++) {
+			cellAgents[count[agentCell[i]].fetch_add(1, memory_order_relaxed)] = (unsigned int)i;
+		}
+	});
+
+	//The threads filled the cells in whatever order they got there. Sorting each (small) cell by agent index makes the order, and with it the floating point results, the same on every run.
+	pool.parallelFor(cells, pool.grainFor(cells, 4096), [&](size_t begin, size_t end, int thread) {
+		for (size_t c = begin;c < end;c++) {
+			unsigned int* agents = cellAgents.data();
+			for (unsigned int k = cellStart[c] + 1;k < cellStart[c + 1];k++) {
+				unsigned int agent = agents[k];
+				unsigned int slot = k;
+				while (slot > cellStart[c] && agents[slot - 1] > agent) {
+					agents[slot] = agents[slot - 1];
+					slot--;
+				}
+				agents[slot] = agent;
+			}
+		}
+	});
+}
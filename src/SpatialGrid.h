@@ -0,0 +1,171 @@
+#pragma once
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <vector>
+#include "ThreadPool.h"
+
+//A uniform grid over the simulation box, used as the broad phase of the collision check.
+//The cells are at least as wide as the largest circle, so two circles can only overlap if they are in the same or in neighboring cells.
+//The agents are bucketed with a counting sort: cellAgents holds the agent indices ordered by cell, and cellStart[c] is where cell c begins in it.
+class SpatialGrid
+{
+	int cellsPerSide;
+	double origin;
+	double cellSize;
+	double inverseCellSize;
+
+	std::vector<unsigned int> agentCell;
+	std::vector<unsigned int> cellStart;
+	std::vector<unsigned int> cellAgents;
+	std::vector<unsigned int> blockTotal;
+
+	//Per-cell counters that are incremented from several threads at once while building
+	std::unique_ptr<std::atomic<unsigned int>[]> cellCount;
+	size_t cellCountCapacity;
+
+public:
+	SpatialGrid();
+
+	//Buckets n agents inside the box [-boxSize, boxSize]^2 into cells of at least minCellSize.
+	//The cells are made bigger when needed so there are never more than about two cells per agent.
+	void build(const double* x, const double* y, size_t n, double boxSize, double minCellSize, ThreadPool& pool);
+
+	int getCellsPerSide() const
+	{
+		return cellsPerSide;
+	}
+
+	double getCellSize() const
+	{
+		return cellSize;
+	}
+
+	int cellCoordinate(double position) const
+	{
+		int cell = (int)((position - origin) * inverseCellSize);
+		if (cell < 0) {
+			return 0;
+		}
+		if (cell >= cellsPerSide) {
+			return cellsPerSide - 1;
+		}
+		return cell;
+	}
+
+	//Calls visit(j) for every agent j in the cell containing (x, y) and in the eight cells around it, including the agent at (x, y) itself
+	template<class F>
+	void forEachNeighbor(double x, double y, const F& visit) const
+	{
+		int cellX = cellCoordinate(x);
+		int cellY = cellCoordinate(y);
+		int firstX = cellX > 0 ? cellX - 1 : 0;
+		int lastX = cellX < cellsPerSide - 1 ? cellX + 1 : cellsPerSide - 1;
+		int firstY = cellY > 0 ? cellY - 1 : 0;
+		int lastY = cellY < cellsPerSide - 1 ? cellY + 1 : cellsPerSide - 1;
+
+		for (int row = firstY;row <= lastY;row++) {
+			//Neighboring cells in a row are next to each other in cellAgents, so a whole row is one contiguous range
+			unsigned int begin = cellStart[row * cellsPerSide + firstX];
+			unsigned int end = cellStart[row * cellsPerSide + lastX + 1];
+			for (unsigned int k = begin;k < end;k++) {
+				visit(cellAgents[k]);
+			}
+		}
+	}
+
+	//How many agents forEachInRange() would visit
+	size_t countInRange(double x, double y, double range) const
+	{
+		int firstX = cellCoordinate(x - range);
+		int lastX = cellCoordinate(x + range);
+		int firstY = cellCoordinate(y - range);
+		int lastY = cellCoordinate(y + range);
+
+		size_t count = 0;
+		for (int row = firstY;row <= lastY;row++) {
+			count += cellStart[row * cellsPerSide + lastX + 1] - cellStart[row * cellsPerSide + firstX];
+		}
+		return count;
+	}
+
+	//Calls visit(j) for every agent j in the cells overlapping the square of half-width range around (x, y), which holds every agent closer than range.
+	//The cells don't have to be as wide as range: the rows are contiguous in cellAgents, so a wide query costs one range per row plus the agents in it.
+	template<class F>
+	void forEachInRange(double x, double y, double range, const F& visit) const
+	{
+		int firstX = cellCoordinate(x - range);
+		int lastX = cellCoordinate(x + range);
+		int firstY = cellCoordinate(y - range);
+		int lastY = cellCoordinate(y + range);
+
+		for (int row = firstY;row <= lastY;row++) {
+			unsigned int begin = cellStart[row * cellsPerSide + firstX];
+			unsigned int end = cellStart[row * cellsPerSide + lastX + 1];
+			for (unsigned int k = begin;k < end;k++) {
+				visit(cellAgents[k]);
+			}
+		}
+	}
+
+	//Calls visit(j) for every agent j in the cells from column first to column last of a row, where rows and columns past the sides of the grid wrap around to the other side (for a periodic box)
+	template<class F>
+	void forEachInRowWrapped(int row, int first, int last, const F& visit) const
+	{
+		row = (row % cellsPerSide + cellsPerSide) % cellsPerSide;
+		if (last - first + 1 >= cellsPerSide) {
+			first = 0;
+			last = cellsPerSide - 1;
+		}
+		else {
+			first = (first % cellsPerSide + cellsPerSide) % cellsPerSide;
+			last = (last % cellsPerSide + cellsPerSide) % cellsPerSide;
+		}
+
+		//A range that wraps around is the end of the row and then its start
+		const unsigned int* rowStart = &cellStart[row * cellsPerSide];
+		unsigned int begin = rowStart[first];
+		unsigned int end = first <= last ? rowStart[last + 1] : rowStart[cellsPerSide];
+		for (unsigned int k = begin;k < end;k++) {
+			visit(cellAgents[k]);
+		}
+		if (first > last) {
+			for (unsigned int k = rowStart[0];k < rowStart[last + 1];k++) {
+				visit(cellAgents[k]);
+			}
+		}
+	}
+
+	//forEachNeighbor() for a periodic box, where the cells along each side of the grid are next to the ones along the opposite side
+	template<class F>
+	void forEachNeighborWrapped(double x, double y, const F& visit) const
+	{
+		int cellX = cellCoordinate(x);
+		int cellY = cellCoordinate(y);
+
+		//With fewer than three rows the rows above and below would be visited twice
+		int firstRow = cellsPerSide < 3 ? 0 : cellY - 1;
+		int rows = cellsPerSide < 3 ? cellsPerSide : 3;
+		for (int row = firstRow;row < firstRow + rows;row++) {
+			forEachInRowWrapped(row, cellX - 1, cellX + 1, visit);
+		}
+	}
+
+	//forEachInRange() for a periodic box, where the square around (x, y) continues on the other side of the box
+	template<class F>
+	void forEachInRangeWrapped(double x, double y, double range, const F& visit) const
+	{
+		int firstX = (int)std::floor((x - range - origin) * inverseCellSize);
+		int lastX = (int)std::floor((x + range - origin) * inverseCellSize);
+		int firstY = (int)std::floor((y - range - origin) * inverseCellSize);
+		int lastY = (int)std::floor((y + range - origin) * inverseCellSize);
+		if (lastY - firstY + 1 >= cellsPerSide) {
+			firstY = 0;
+			lastY = cellsPerSide - 1;
+		}
+
+		for (int row = firstY;row <= lastY;row++) {
+			forEachInRowWrapped(row, firstX, lastX, visit);
+		}
+	}
+};
@@ -0,0 +1,133 @@
+#include "SweepAndPrune.h"
+#include <algorithm>
+
+using namespace std;
+
+//How much more spread out the agents have to be along the other axis before the sort switches to it. Switching means sorting from scratch, so it shouldn't flip back and forth.
+#define AXIS_HYSTERESIS 1.25
+
+//Agents summed together when working out how spread out they are. The blocks don't depend on the number of threads, so neither does the rounding of the sums.
+#define AXIS_BLOCK 4096
+
+SweepAndPrune::SweepAndPrune()
+{
+	axis = 0;
+	sorted = false;
+	lastMoves = 0;
+}
+
+//The axis with the larger variance of the positions
+int SweepAndPrune::chooseAxis(const double* x, const double* y, size_t n, ThreadPool& pool)
+{
+	//Every block of agents is summed on its own and the blocks are added up in order, so the variances, and the axis they pick, come out the same whatever the threads and however the blocks are shared between them
+	size_t blocks = (n + AXIS_BLOCK - 1) / AXIS_BLOCK;
+	blockSums.resize(blocks * 4);
+	pool.parallelFor(blocks, pool.grainFor(blocks, 1), [&](size_t begin, size_t end, int thread) {
+		for (size_t block = begin;block < end;block++) {
+			size_t first = block * AXIS_BLOCK;
+			size_t last = first + AXIS_BLOCK < n ? first + AXIS_BLOCK : n;
+			double sumX = 0;
+			double sumXX = 0;
+			double sumY = 0;
+			double sumYY = 0;
+			for (size_t i = first;i < last;i++) {
+				sumX += x[i];
+				sumXX += x[i] * x[i];
+				sumY += y[i];
+				sumYY += y[i] * y[i];
+			}
+			double* sums = &blockSums[block * 4];
+			sums[0] = sumX;
+			sums[1] = sumXX;
+			sums[2] = sumY;
+			sums[3] = sumYY;
+		}
+	});
+
+	double sums[4] = { 0, 0, 0, 0 };
+	for (size_t block = 0;block < blocks;block++) {
+		for (int i = 0;i < 4;i++) {
+			sums[i] += blockSums[block * 4 + i];
+		}
+	}
+	double varianceX = sums[1] / n - (sums[0] / n) * (sums[0] / n);
+	double varianceY = sums[3] / n - (sums[2] / n) * (sums[2] / n);
+
+	if (axis == 0 && varianceY > AXIS_HYSTERESIS * varianceX) {
+		return 1;
+	}
+	if (axis == 1 && varianceX > AXIS_HYSTERESIS * varianceY) {
+		return 0;
+	}
+	return axis;
+}
+
+void SweepAndPrune::build(const double* x, const double* y, size_t n, ThreadPool& pool)
+{
+	if (n == 0) {
+		order.clear();
+		rank.clear();
+		along.clear();
+		across.clear();
+		return;
+	}
+
+	int bestAxis = chooseAxis(x, y, n, pool);
+	if (bestAxis != axis || order.size() != n) {
+		axis = bestAxis;
+		sorted = false;
+	}
+	const double* first = axis == 0 ? x : y;
+	const double* second = axis == 0 ? y : x;
+
+	order.resize(n);
+	rank.resize(n);
+	along.resize(n);
+	across.resize(n);
+	lastMoves = 0;
+
+	if (!sorted) {
+		for (size_t i = 0;i < n;i++) {
+			order[i] = (unsigned int)i;
+		}
+		//Ties are broken by index, so the order only depends on the positions
+		sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b) {
+			return first[a] < first[b] || (first[a] == first[b] && a < b);
+		});
+		sorted = true;
+	}
+
+	pool.parallelFor(n, pool.grainFor(n), [&](size_t begin, size_t end, int thread) {
+		for (size_t k = begin;k < end;k++) {
+			along[k] = first[order[k]];
+			across[k] = second[order[k]];
+		}
+	});
+
+	//Everything is nearly in place after a step, so each agent only moves back a few places
+	for (size_t k = 1;k < n;k++) {
+		double a = along[k];
+		if (!(a < along[k - 1])) {
+			continue;
+		}
+		double c = across[k];
+		unsigned int agent = order[k];
+		size_t m = k;
+		while (m > 0 && a < along[m - 1]) {
+			along[m] = along[m - 1];
+			across[m] = across[m - 1];
+			order[m] = order[m - 1];
+			m--;
+		}
+		along[m] = a;
+		across[m] = c;
+		order[m] = agent;
+		lastMoves += k - m;
+	}
+
+	pool.parallelFor(n, pool.grainFor(n), [&](size_t begin, size_t end, int thread) {
+		for (size_t k = begin;k < end;k++) {
+			rank[order[k]] = (unsigned int)k;
+		}
+	});
+}
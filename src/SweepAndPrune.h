@@ -0,0 +1,70 @@
+#pragma once
+#include <cmath>
+#include <vector>
+#include "ThreadPool.h"
+
+//A broad phase that sorts the agents along one axis and only looks at the agents whose coordinate along it is within range (sort and sweep).
+//It sorts along whichever axis the agents are more spread out on, so a crowd strung out along a corridor or a queue only gets compared with the few agents next to it along the corridor, however unevenly it fills the box.
+//The agents barely move between steps, so the order of the last step is nearly sorted already, and an insertion sort puts it right in close to linear time.
+class SweepAndPrune
+{
+	//0 sorts along x, 1 along y
+	int axis;
+	bool sorted;
+
+	//The agents in sorted order, where every agent is in that order, and the coordinates along and across the axis in sorted order, so a sweep reads memory in order
+	std::vector<unsigned int> order;
+	std::vector<unsigned int> rank;
+	std::vector<double> along;
+	std::vector<double> across;
+
+	//Sums of x, x^2, y and y^2 over every block of AXIS_BLOCK agents
+	std::vector<double> blockSums;
+	unsigned long long lastMoves;
+
+	int chooseAxis(const double* x, const double* y, size_t n, ThreadPool& pool);
+
+public:
+	SweepAndPrune();
+
+	//Sorts the n agents by their positions. The first build, and the first one after invalidate(), sorts from scratch.
+	void build(const double* x, const double* y, size_t n, ThreadPool& pool);
+
+	//Call when the agents have been renumbered, as the order of the last build doesn't mean anything anymore
+	void invalidate()
+	{
+		sorted = false;
+	}
+
+	int getAxis() const
+	{
+		return axis;
+	}
+
+	//How many places the insertion sort of the last build moved agents by in total, which is small as long as the agents move a little each step
+	unsigned long long getLastMoves() const
+	{
+		return lastMoves;
+	}
+
+	//Calls visit(j) for every other agent j less than range away from agent along both axes
+	template<class F>
+	void forEachInRange(size_t agent, double range, const F& visit) const
+	{
+		size_t count = order.size();
+		size_t k = rank[agent];
+		double a = along[k];
+		double c = across[k];
+
+		for (size_t m = k + 1;m < count && along[m] - a < range;m++) {
+			if (std::fabs(across[m] - c) < range) {
+				visit(order[m]);
+			}
+		}
+		for (size_t m = k;m > 0 && a - along[m - 1] < range;m--) {
+			if (std::fabs(across[m - 1] - c) < range) {
+				visit(order[m - 1]);
+			}
+		}
+	}
+};
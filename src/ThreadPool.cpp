@@ -0,0 +1,127 @@
+#include "ThreadPool.h"
+#include <string>
+#include "Profiler.h"
+
+using namespace std;
+
+ThreadPool::ThreadPool(int numThreads)
+{
+	if (numThreads <= 0) {
+		numThreads = (int)thread::hardware_concurrency();
+		if (numThreads <= 0) {
+			numThreads = 1;
+		}
+	}
+
+	stopping = false;
+	generation = 0;
+	busyWorkers = 0;
+	function = NULL;
+	task = NULL;
+	count = 0;
+	grain = 1;
+	chunks = 0;
+	nextChunk.store(0);
+
+	for (int i = 1;i < numThreads;i++) {
+		workers.push_back(thread(&ThreadPool::workerLoop, this, i));
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		lock_guard<mutex> guard(lock);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (size_t i = 0;i < workers.size();i++) {
+		workers[i].join();
+	}
+}
+
+size_t ThreadPool::grainFor(size_t count, size_t minimum) const
+{
+	size_t grain = count / (size() * 8);
+	return grain < minimum ? minimum : grain;
+}
+
+void ThreadPool::runChunks(int thread)
+{
+	//Workers that were started before the counters were switched on attach the first time they get work afterwards
+	if (Profiler::counters()) {
+		PerfCounters::attachThread();
+	}
+
+	for (size_t chunk = nextChunk.fetch_add(1);chunk < chunks;chunk = nextChunk.fetch_add(1)) {
+		TRACE_SCOPE("task");
+		size_t begin = chunk * grain;
+		size_t end = begin + grain < count ? begin + grain : count;
+		function(task, begin, end, thread);
+	}
+}
+
+void ThreadPool::workerLoop(int thread)
+{
+	string name = "worker " + to_string(thread);
+	TraceRecorder::setThreadName(name.c_str());
+
+	unsigned long long seen = 0;
+	while (true) {
+		{
+			unique_lock<mutex> guard(lock);
+			wake.wait(guard, [&] { return stopping || generation != seen; });
+			if (stopping) {
+				return;
+			}
+			seen = generation;
+		}
+
+		runChunks(thread);
+
+		{
+			lock_guard<mutex> guard(lock);
+			busyWorkers--;
+			if (busyWorkers == 0) {
+				done.notify_one();
+			}
+		}
+	}
+}
+
+void ThreadPool::run(TaskFunction function, const void* task, size_t count, size_t grain)
+{
+	if (count == 0) {
+		return;
+	}
+	if (grain == 0) {
+		grain = 1;
+	}
+
+	//Not worth waking anyone up for
+	if (workers.empty() || count <= grain) {
+		TRACE_SCOPE("task");
+		function(task, 0, count, 0);
+		return;
+	}
+
+	{
+		lock_guard<mutex> guard(lock);
+		ThreadPool::function = function;
+		ThreadPool::task = task;
+		ThreadPool::count = count;
+		ThreadPool::grain = grain;
+		chunks = (count + grain - 1) / grain;
+		nextChunk.store(0);
+		busyWorkers = (int)workers.size();
+		generation++;
+	}
+	wake.notify_all();
+
+	runChunks(0);
+
+	//Whatever the calling thread spends here is load imbalance between the threads
+	TRACE_SCOPE("wait");
+	unique_lock<mutex> guard(lock);
+	done.wait(guard, [&] { return busyWorkers == 0; });
+}
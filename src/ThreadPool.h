@@ -0,0 +1,61 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//A fixed set of worker threads that split loops over the population between them.
+//The thread calling parallelFor() works on the loop as well, so a pool of size 1 has no workers and runs everything inline.
+class ThreadPool
+{
+	typedef void (*TaskFunction)(const void* task, size_t begin, size_t end, int thread);
+
+	std::vector<std::thread> workers;
+	std::mutex lock;
+	std::condition_variable wake;
+	std::condition_variable done;
+	bool stopping;
+	unsigned long long generation;
+	int busyWorkers;
+
+	//The loop currently being worked on
+	TaskFunction function;
+	const void* task;
+	size_t count;
+	size_t grain;
+	size_t chunks;
+	std::atomic<size_t> nextChunk;
+
+	template<class F>
+	static void invoke(const void* task, size_t begin, size_t end, int thread)
+	{
+		(*(const F*)task)(begin, end, thread);
+	}
+
+	void runChunks(int thread);
+	void workerLoop(int thread);
+	void run(TaskFunction function, const void* task, size_t count, size_t grain);
+
+public:
+	//numThreads counts the calling thread too. 0 uses one thread per hardware thread.
+	ThreadPool(int numThreads = 0);
+	~ThreadPool();
+
+	int size() const
+	{
+		return (int)workers.size() + 1;
+	}
+
+	//A chunk size that gives every thread several chunks, so a slow chunk doesn't hold the others up, but is still big enough to amortize handing it out
+	size_t grainFor(size_t count, size_t minimum = 1024) const;
+
+	//Calls task(begin, end, thread) for consecutive chunks of [0, count) of at most grain items, and returns once all of them have finished.
+	//thread is in [0, size()) and is unique among the calls running at the same time, so it can index per-thread scratch data.
+	template<class F>
+	void parallelFor(size_t count, size_t grain, const F& task)
+	{
+		run(&invoke<F>, &task, count, grain);
+	}
+};
@@ -0,0 +1,79 @@
+#include "TimerWheel.h"
+
+using namespace std;
+
+#define TIMER_WHEEL_MASK ((1ULL << TIMER_WHEEL_BITS) - 1)
+
+TimerWheel::TimerWheel()
+{
+	now = 0;
+	pending = 0;
+}
+
+void TimerWheel::clear(unsigned long long step)
+{
+	for (int level = 0;level < TIMER_WHEEL_LEVELS;level++) {
+		for (unsigned long long slot = 0;slot <= TIMER_WHEEL_MASK;slot++) {
+			slots[level][slot].clear();
+		}
+	}
+	overflow.clear();
+	now = step;
+	pending = 0;
+}
+
+void TimerWheel::schedule(unsigned int id, unsigned long long due)
+{
+	Timer timer;
+	timer.id = id;
+	timer.due = due < now ? now : due;
+	insert(timer);
+	pending++;
+}
+
+//Puts a timer on the lowest level that reaches far enough ahead
+void TimerWheel::insert(const Timer& timer)
+{
+	unsigned long long ahead = timer.due - now;
+	for (int level = 0;level < TIMER_WHEEL_LEVELS;level++) {
+		int shift = level * TIMER_WHEEL_BITS;
+		if ((ahead >> shift) <= TIMER_WHEEL_MASK) {
+			slots[level][(timer.due >> shift) & TIMER_WHEEL_MASK].push_back(timer);
+			return;
+		}
+	}
+	overflow.push_back(timer);
+}
+
+//Takes the timers out of a slot and puts each one back on the level it belongs on now, which is always a lower one
+void TimerWheel::cascade(vector<Timer>& timers)
+{
+	moving.swap(timers);
+	for (size_t i = 0;i < moving.size();i++) {
+		insert(moving[i]);
+	}
+	moving.clear();
+}
+
+void TimerWheel::expire(vector<unsigned int>& expired)
+{
+	//Whenever a level has gone round once, spread out the next slot of the level above over it
+	for (int level = 1;level < TIMER_WHEEL_LEVELS;level++) {
+		int shift = level * TIMER_WHEEL_BITS;
+		if ((now & ((1ULL << shift) - 1)) != 0) {
+			break;
+		}
+		cascade(slots[level][(now >> shift) & TIMER_WHEEL_MASK]);
+		if (level == TIMER_WHEEL_LEVELS - 1 && (now & ((1ULL << (shift + TIMER_WHEEL_BITS)) - 1)) == 0) {
+			cascade(overflow);
+		}
+	}
+
+	vector<Timer>& due = slots[0][now & TIMER_WHEEL_MASK];
+	for (size_t i = 0;i < due.size();i++) {
+		expired.push_back(due[i].id);
+	}
+	pending -= due.size();
+	due.clear();
+	now++;
+}
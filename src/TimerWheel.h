@@ -0,0 +1,52 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+//Each level of the timer wheel has 2^TIMER_WHEEL_BITS slots
+#define TIMER_WHEEL_BITS 8
+#define TIMER_WHEEL_LEVELS 4
+
+//Remembers which ids come due at which step, for things that happen a known number of steps after something else, like recovering after an infection.
+//Level 0 has a slot for each of the next 2^TIMER_WHEEL_BITS steps. The slots of every level above are 2^TIMER_WHEEL_BITS times as long as the ones below, and each time the level below has gone round once, the next slot of the level above is spread out over it.
+//So scheduling a timer is O(1), and a timer gets moved at most TIMER_WHEEL_LEVELS times however far ahead it is. Timers more than 2^(TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS) steps ahead wait in a list that is looked at once per turn of the top level.
+class TimerWheel
+{
+	struct Timer
+	{
+		unsigned int id;
+		unsigned long long due;
+	};
+
+	std::vector<Timer> slots[TIMER_WHEEL_LEVELS][1 << TIMER_WHEEL_BITS];
+	std::vector<Timer> overflow;
+	std::vector<Timer> moving;
+
+	//The next step to expire
+	unsigned long long now;
+	size_t pending;
+
+	void insert(const Timer& timer);
+	void cascade(std::vector<Timer>& timers);
+
+public:
+	TimerWheel();
+
+	//Drops every timer, and makes step the next one to expire
+	void clear(unsigned long long step);
+
+	//due must not be before the next step to expire
+	void schedule(unsigned int id, unsigned long long due);
+
+	//Appends the ids that are due at the next step to expired, and moves on to the step after
+	void expire(std::vector<unsigned int>& expired);
+
+	unsigned long long nextStep() const
+	{
+		return now;
+	}
+
+	size_t size() const
+	{
+		return pending;
+	}
+};
@@ -0,0 +1,140 @@
+#include "Trace.h"
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+struct TraceEvent
+{
+	const char* name;
+	long long timestamp;
+	char phase;
+};
+
+//Every thread appends to its own buffer, so threads never contend with each other while recording.
+//The mutex is only ever contended while stop() is writing the file.
+struct TraceThreadBuffer
+{
+	int threadId;
+	string threadName;
+	mutex lock;
+	vector<TraceEvent> events;
+};
+
+atomic<bool> TraceRecorder::recording(false);
+
+static mutex buffersLock;
+static vector<unique_ptr<TraceThreadBuffer>> buffers;
+static thread_local TraceThreadBuffer* localBuffer = nullptr;
+static atomic<long long> traceStart(0);
+
+static long long now()
+{
+	return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//Buffers are never freed, so a thread that exits while recording still shows up in the file
+static TraceThreadBuffer* threadBuffer()
+{
+	if (localBuffer == nullptr) {
+		lock_guard<mutex> guard(buffersLock);
+		buffers.push_back(unique_ptr<TraceThreadBuffer>(new TraceThreadBuffer()));
+		localBuffer = buffers.back().get();
+		localBuffer->threadId = (int)buffers.size();
+		localBuffer->threadName = "thread " + to_string(localBuffer->threadId);
+	}
+	return localBuffer;
+}
+
+static void record(const char* name, char phase)
+{
+	TraceThreadBuffer* buffer = threadBuffer();
+	TraceEvent event;
+	event.name = name;
+	event.timestamp = now();
+	event.phase = phase;
+
+	lock_guard<mutex> guard(buffer->lock);
+	buffer->events.push_back(event);
+}
+
+//Event names come from the source code, but quotes and backslashes would still break the JSON
+static void writeEscaped(FILE* file, const char* text)
+{
+	for (const char* c = text;*c != '\0';c++) {
+		if (*c == '"' || *c == '\\') {
+			fputc('\\', file);
+		}
+		fputc(*c, file);
+	}
+}
+
+void TraceRecorder::start()
+{
+	lock_guard<mutex> guard(buffersLock);
+	for (size_t i = 0;i < buffers.size();i++) {
+		lock_guard<mutex> bufferGuard(buffers[i]->lock);
+		buffers[i]->events.clear();
+	}
+	traceStart.store(now());
+	recording.store(true);
+}
+
+bool TraceRecorder::stop(const char* path)
+{
+	recording.store(false);
+
+	FILE* file = fopen(path, "w");
+	if (file == NULL) {
+		return false;
+	}
+
+	long long start = traceStart.load();
+	bool first = true;
+
+	fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+	lock_guard<mutex> guard(buffersLock);
+	for (size_t i = 0;i < buffers.size();i++) {
+		TraceThreadBuffer* buffer = buffers[i].get();
+		lock_guard<mutex> bufferGuard(buffer->lock);
+
+		//Metadata event so the viewer shows a readable name for the thread's row
+		fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"", first ? "" : ",\n", buffer->threadId);
+		writeEscaped(file, buffer->threadName.c_str());
+		fprintf(file, "\"}}");
+		first = false;
+
+		for (size_t e = 0;e < buffer->events.size();e++) {
+			const TraceEvent& event = buffer->events[e];
+			fprintf(file, ",\n{\"name\":\"");
+			writeEscaped(file, event.name);
+			fprintf(file, "\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%d}", event.phase, (event.timestamp - start) / 1000.0, buffer->threadId);
+		}
+		buffer->events.clear();
+	}
+
+	fprintf(file, "\n]}\n");
+	return fclose(file) == 0;
+}
+
+void TraceRecorder::setThreadName(const char* name)
+{
+	TraceThreadBuffer* buffer = threadBuffer();
+	lock_guard<mutex> guard(buffer->lock);
+	buffer->threadName = name;
+}
+
+void TraceRecorder::begin(const char* name)
+{
+	record(name, 'B');
+}
+
+void TraceRecorder::end(const char* name)
+{
+	record(name, 'E');
+}
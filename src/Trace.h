@@ -0,0 +1,65 @@
+#pragma once
+#include <atomic>
+
+//Records begin/end events for every thread that runs simulation or rendering work, and writes them out as a Chrome trace JSON file.
+//The file can be opened in chrome://tracing or https://ui.perfetto.dev to see how long each phase took on each thread.
+//Recording is switched on and off at runtime. While it is off, a trace scope costs a single relaxed atomic load.
+//Defining DISABLE_TRACING at compile time removes the trace scopes completely.
+class TraceRecorder
+{
+	static std::atomic<bool> recording;
+
+public:
+	//Clears anything recorded earlier and starts recording
+	static void start();
+
+	//Stops recording and writes every event recorded since start() to the file at path. Returns false if the file could not be written.
+	static bool stop(const char* path);
+
+	static bool isRecording()
+	{
+#ifdef DISABLE_TRACING
+		return false;
+#else
+		return recording.load(std::memory_order_relaxed);
+#endif
+	}
+
+	//Names the calling thread in the trace viewer, e.g. "main" or "worker 3"
+	static void setThreadName(const char* name);
+
+	//The name must be a string literal (or otherwise outlive the recording), as only the pointer is stored
+	static void begin(const char* name);
+	static void end(const char* name);
+};
+
+//Emits a begin event when constructed and the matching end event when it goes out of scope
+class TraceScope
+{
+	const char* name;
+	bool active;
+
+public:
+	TraceScope(const char* name) : name(name), active(TraceRecorder::isRecording())
+	{
+		if (active) {
+			TraceRecorder::begin(name);
+		}
+	}
+
+	~TraceScope()
+	{
+		if (active) {
+			TraceRecorder::end(name);
+		}
+	}
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+
+#ifdef DISABLE_TRACING
+#define TRACE_SCOPE(name)
+#else
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
+#endif
@@ -0,0 +1,59 @@
+#pragma once
+#include <atomic>
+
+//Hands values from one writer thread to one reader thread without either of them ever waiting for the other.
+//There are three slots: the writer owns one, the reader owns one, and the third holds the latest value that was published. Publishing and picking up are a single atomic exchange with that third slot each, so the reader always gets the newest complete value, and values the reader never got to are simply overwritten.
+template<class T>
+class TripleBuffer
+{
+	//Set next to the slot index while the middle slot holds a value the reader hasn't picked up yet
+	static const int FRESH = 4;
+	static const int INDEX = 3;
+
+	T slots[3];
+	std::atomic<int> middle;
+	int back;
+	int front;
+
+public:
+	TripleBuffer() : middle(1), back(0), front(2)
+	{
+	}
+
+	//Direct access to the slots, to set them up before the writer and reader start
+	T& slot(int index)
+	{
+		return slots[index];
+	}
+
+	//Writer side: the slot to fill in, then hand it over with publish()
+	T& writeBuffer()
+	{
+		return slots[back];
+	}
+
+	void publish()
+	{
+		back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & INDEX;
+	}
+
+	//Reader side: whether there is something newer than readBuffer(), and update() to switch to it. The slot read until then goes back to the writer.
+	bool hasUpdate() const
+	{
+		return (middle.load(std::memory_order_acquire) & FRESH) != 0;
+	}
+
+	bool update()
+	{
+		if (!hasUpdate()) {
+			return false;
+		}
+		front = middle.exchange(front, std::memory_order_acq_rel) & INDEX;
+		return true;
+	}
+
+	const T& readBuffer() const
+	{
+		return slots[front];
+	}
+};